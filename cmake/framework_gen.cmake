@@ -176,6 +176,42 @@ add_custom_command(
     DEPENDS ${FWK_TYPE_FILE_LIST}
 )
 
+# Type pools
+if(CONFIG_FWK_TYPE_POOLS)
+    set(FWK_POOL_ENUM "")
+    set(FWK_POOL_SLABS "")
+    set(FWK_POOL_TABLE "")
+    set(FWK_POOL_SIZE "")
+    set(FWK_POOL_COUNT "0")
+
+    foreach (FWK_TYPE_FILE IN LISTS FWK_TYPE_FILE_LIST)
+        # Declarations are read at configure time, re-run CMake when a type file changes
+        set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${FWK_TYPE_FILE})
+        file(STRINGS ${FWK_TYPE_FILE} FWK_POOL_LINES REGEX "^[ \t]*FWK_TYPE_POOL[ \t]*\\(")
+
+        foreach (FWK_POOL_LINE IN LISTS FWK_POOL_LINES)
+            string(REGEX MATCH "FWK_TYPE_POOL[ \t]*\\([ \t]*([A-Za-z_][A-Za-z0-9_]*)[ \t]*,[ \t]*([^) \t]+)[ \t]*\\)" FWK_POOL_MATCH "${FWK_POOL_LINE}")
+            if(NOT FWK_POOL_MATCH)
+                message(FATAL_ERROR "Invalid FWK_TYPE_POOL declaration in ${FWK_TYPE_FILE}: ${FWK_POOL_LINE}")
+            endif()
+            set(FWK_POOL_TYPE ${CMAKE_MATCH_1})
+            set(FWK_POOL_NUM ${CMAKE_MATCH_2})
+
+            string(APPEND FWK_POOL_ENUM "\tFWK_TYPE_POOL_ID_${FWK_POOL_TYPE},\n")
+            string(APPEND FWK_POOL_SLABS "K_MEM_SLAB_DEFINE_STATIC(fwk_pool_${FWK_POOL_TYPE}, BP_TYPE_POOL_BLOCK_SIZE(${FWK_POOL_TYPE}), ${FWK_POOL_NUM}, sizeof(void *));\n")
+            string(APPEND FWK_POOL_TABLE "\t{ &fwk_pool_${FWK_POOL_TYPE}, \"${FWK_POOL_TYPE}\", sizeof(${FWK_POOL_TYPE}), ${FWK_POOL_NUM} },\n")
+            string(APPEND FWK_POOL_SIZE " + \\\n\t(BP_TYPE_POOL_BLOCK_SIZE(${FWK_POOL_TYPE}) * (${FWK_POOL_NUM}))")
+
+            # Increment type pool count
+            math(EXPR FWK_POOL_COUNT "${FWK_POOL_COUNT}+1")
+        endforeach()
+    endforeach()
+
+    configure_file(${CMAKE_CURRENT_SOURCE_DIR}/template/template_pools.h.in ${GENERATED_PATH}/framework_pools.h @ONLY)
+    configure_file(${CMAKE_CURRENT_SOURCE_DIR}/template/template_pools.c.in ${GENERATED_PATH}/framework_pools.c @ONLY)
+    zephyr_sources(${GENERATED_PATH}/framework_pools.c)
+endif()
+
 # Combined
 
 # Make zephyr depend on the framework ID/message code generation as a dependency
@@ -0,0 +1,178 @@
+# Host (Linux) build of the framework library using the POSIX backend.
+#
+# The configuration normally comes from Kconfig.  On a host it comes from
+# these cache variables (cmake -DFWK_HOST_SEG_MSG=ON ...).  The integer
+# values default to their Kconfig defaults.
+
+set(CONFIG_BUFFER_POOL_SIZE 8192 CACHE STRING "Buffer pool size in bytes")
+set(CONFIG_FWK_MAX_MSG_RECEIVERS 32 CACHE STRING "Maximum number of receivers")
+set(CONFIG_FRAMEWORK_LOG_LEVEL 2 CACHE STRING "Log level (0-4)")
+set(CONFIG_FWK_UNICAST_CACHE_SIZE 8 CACHE STRING
+  "Unicast route cache entries (power of two)")
+set(CONFIG_FWK_UNREGISTER_TIMEOUT_MS 100 CACHE STRING
+  "Maximum time unregister waits for senders")
+set(CONFIG_FWK_SEG_MSG_SEGMENT_SIZE 128 CACHE STRING
+  "Payload bytes in each segment")
+set(CONFIG_FWK_ASYNC_MAX_PENDING 8 CACHE STRING
+  "Maximum number of pending requests")
+set(CONFIG_FWK_TRAFFIC_EDGES 64 CACHE STRING
+  "Traffic matrix edges (power of two)")
+set(CONFIG_BUFFER_POOL_MAX_SITES 16 CACHE STRING
+  "Number of allocation sites that are tracked")
+set(CONFIG_BUFFER_POOL_QUARANTINE_SIZE 2 CACHE STRING
+  "Number of freed buffers held for use after free checks")
+set(CONFIG_BUFFER_POOL_INTEGRITY_SAMPLE 16 CACHE STRING
+  "Put one of every N freed buffers in quarantine")
+set(CONFIG_BUFFER_POOL_PRESSURE_LOW_PERCENT 25 CACHE STRING
+  "Remaining space (percent) for low pressure")
+set(CONFIG_BUFFER_POOL_PRESSURE_HIGH_PERCENT 10 CACHE STRING
+  "Remaining space (percent) for high pressure")
+
+option(FWK_HOST_BUFFER_POOL_STATS "Buffer pool statistics" OFF)
+option(FWK_HOST_SEG_MSG "Segmented messages" OFF)
+option(FWK_HOST_ASYNC "Asynchronous requests" OFF)
+option(FWK_HOST_SCRATCH "Receiver scratch arenas" OFF)
+option(FWK_HOST_TRAFFIC "Traffic matrix" OFF)
+option(FWK_HOST_VIRTUAL_TIME "Virtual time (deterministic simulation)" OFF)
+option(FWK_HOST_LIVENESS "Receiver liveness counters" OFF)
+option(FWK_HOST_QUOTAS "Per ID buffer quotas" OFF)
+option(FWK_HOST_TYPE_POOLS "Type pools (the application defines the table)" OFF)
+option(FWK_HOST_MSG_PRIORITY "Message priority inheritance" OFF)
+option(FWK_HOST_ALIGNED "Aligned buffers" OFF)
+option(FWK_HOST_SITE_STATS "Buffer pool statistics by allocation site" OFF)
+option(FWK_HOST_INTEGRITY "Buffer integrity checks" OFF)
+option(FWK_HOST_UNICAST_CACHE "Unicast route cache" OFF)
+option(FWK_HOST_ADMISSION "Buffer pool admission control" OFF)
+option(FWK_HOST_TESTS "Build the host tests" ON)
+
+# Each option is a set of definitions and sources.  The tests build a
+# library for each option so that every option is compiled.
+set(FWK_HOST_OPTIONS
+  BUFFER_POOL_STATS
+  SEG_MSG
+  ASYNC
+  SCRATCH
+  TRAFFIC
+  VIRTUAL_TIME
+  LIVENESS
+  QUOTAS
+  TYPE_POOLS
+  MSG_PRIORITY
+  ALIGNED
+  SITE_STATS
+  INTEGRITY
+  UNICAST_CACHE
+  ADMISSION
+)
+
+set(FWK_HOST_BUFFER_POOL_STATS_DEFINITIONS CONFIG_BUFFER_POOL_STATS=1)
+
+set(FWK_HOST_SEG_MSG_DEFINITIONS
+  CONFIG_FWK_SEG_MSG=1
+  CONFIG_FWK_SEG_MSG_SEGMENT_SIZE=${CONFIG_FWK_SEG_MSG_SEGMENT_SIZE}
+)
+set(FWK_HOST_SEG_MSG_SOURCES source/FrameworkSegMsg.c)
+
+set(FWK_HOST_ASYNC_DEFINITIONS
+  CONFIG_FWK_ASYNC=1
+  CONFIG_FWK_ASYNC_MAX_PENDING=${CONFIG_FWK_ASYNC_MAX_PENDING}
+)
+set(FWK_HOST_ASYNC_SOURCES source/FrameworkAsync.c)
+
+set(FWK_HOST_SCRATCH_DEFINITIONS CONFIG_FWK_SCRATCH=1)
+
+set(FWK_HOST_TRAFFIC_DEFINITIONS
+  CONFIG_FWK_TRAFFIC=1
+  CONFIG_FWK_TRAFFIC_EDGES=${CONFIG_FWK_TRAFFIC_EDGES}
+)
+set(FWK_HOST_TRAFFIC_SOURCES source/FrameworkTraffic.c)
+
+set(FWK_HOST_VIRTUAL_TIME_DEFINITIONS CONFIG_FWK_POSIX_VIRTUAL_TIME=1)
+
+# The monitor (FrameworkLiveness.c) runs on a work queue, which the host
+# doesn't have.  The counters of each receiver are maintained.
+set(FWK_HOST_LIVENESS_DEFINITIONS CONFIG_FWK_LIVENESS=1)
+
+set(FWK_HOST_QUOTAS_DEFINITIONS CONFIG_BUFFER_POOL_QUOTAS=1)
+
+# fwk_type_pools and fwk_type_pool_count are normally generated from the
+# FWK_TYPE_POOL declarations (framework_pools.c).
+set(FWK_HOST_TYPE_POOLS_DEFINITIONS CONFIG_FWK_TYPE_POOLS=1)
+
+set(FWK_HOST_MSG_PRIORITY_DEFINITIONS CONFIG_FWK_MSG_PRIORITY=1)
+
+set(FWK_HOST_ALIGNED_DEFINITIONS CONFIG_BUFFER_POOL_ALIGNED=1)
+
+# Site statistics depend on the buffer pool statistics
+set(FWK_HOST_SITE_STATS_DEFINITIONS
+  CONFIG_BUFFER_POOL_STATS=1
+  CONFIG_BUFFER_POOL_SITE_STATS=1
+  CONFIG_BUFFER_POOL_MAX_SITES=${CONFIG_BUFFER_POOL_MAX_SITES}
+)
+
+set(FWK_HOST_INTEGRITY_DEFINITIONS
+  CONFIG_BUFFER_POOL_INTEGRITY=1
+  CONFIG_BUFFER_POOL_QUARANTINE_SIZE=${CONFIG_BUFFER_POOL_QUARANTINE_SIZE}
+  CONFIG_BUFFER_POOL_INTEGRITY_SAMPLE=${CONFIG_BUFFER_POOL_INTEGRITY_SAMPLE}
+)
+
+set(FWK_HOST_UNICAST_CACHE_DEFINITIONS
+  CONFIG_FWK_UNICAST_CACHE_SIZE=${CONFIG_FWK_UNICAST_CACHE_SIZE}
+)
+
+set(FWK_HOST_ADMISSION_DEFINITIONS
+  CONFIG_BUFFER_POOL_ADMISSION=1
+  CONFIG_BUFFER_POOL_PRESSURE_LOW_PERCENT=${CONFIG_BUFFER_POOL_PRESSURE_LOW_PERCENT}
+  CONFIG_BUFFER_POOL_PRESSURE_HIGH_PERCENT=${CONFIG_BUFFER_POOL_PRESSURE_HIGH_PERCENT}
+)
+
+set(FWK_HOST_DIR ${CMAKE_CURRENT_LIST_DIR}/..)
+
+find_package(Threads REQUIRED)
+
+# fwk_host_library(<name> [<option>...])
+function(fwk_host_library name)
+  add_library(${name} STATIC
+    ${FWK_HOST_DIR}/source/BufferPool.c
+    ${FWK_HOST_DIR}/source/Framework.c
+    ${FWK_HOST_DIR}/source/FrameworkMsg.c
+    ${FWK_HOST_DIR}/source/FrameworkStubs.c
+    ${FWK_HOST_DIR}/source/FrameworkOsPosix.c
+  )
+
+  target_include_directories(${name} PUBLIC ${FWK_HOST_DIR}/include)
+
+  target_compile_definitions(${name} PUBLIC
+    CONFIG_FWK_POSIX=1
+    CONFIG_FRAMEWORK=1
+    CONFIG_BUFFER_POOL_SIZE=${CONFIG_BUFFER_POOL_SIZE}
+    CONFIG_FWK_MAX_MSG_RECEIVERS=${CONFIG_FWK_MAX_MSG_RECEIVERS}
+    CONFIG_FRAMEWORK_LOG_LEVEL=${CONFIG_FRAMEWORK_LOG_LEVEL}
+    CONFIG_FWK_UNREGISTER_TIMEOUT_MS=${CONFIG_FWK_UNREGISTER_TIMEOUT_MS}
+  )
+
+  foreach(option ${ARGN})
+    foreach(source ${FWK_HOST_${option}_SOURCES})
+      target_sources(${name} PRIVATE ${FWK_HOST_DIR}/${source})
+    endforeach()
+    target_compile_definitions(${name} PUBLIC
+      ${FWK_HOST_${option}_DEFINITIONS})
+  endforeach()
+
+  target_compile_options(${name} PRIVATE -Wall -Wextra)
+  target_link_libraries(${name} PUBLIC Threads::Threads)
+endfunction()
+
+set(FWK_HOST_ENABLED)
+foreach(option ${FWK_HOST_OPTIONS})
+  if(FWK_HOST_${option})
+    list(APPEND FWK_HOST_ENABLED ${option})
+  endif()
+endforeach()
+
+fwk_host_library(framework ${FWK_HOST_ENABLED})
+
+if(FWK_HOST_TESTS)
+  enable_testing()
+  add_subdirectory(${FWK_HOST_DIR}/tests/host ${CMAKE_BINARY_DIR}/tests/host)
+endif()
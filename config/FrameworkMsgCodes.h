@@ -31,8 +31,8 @@ enum FwkMsgCodeEnum {
 	/* Last value (DO NOT DELETE) */
 	NUMBER_OF_FRAMEWORK_MSG_CODES
 };
-BUILD_ASSERT(sizeof(enum FwkMsgCodeEnum) <= sizeof(FwkMsgCode_t),
-		 "Too many message codes");
+BUILD_ASSERT((NUMBER_OF_FRAMEWORK_MSG_CODES - 1) <= FWK_MSG_CODE_MAX,
+	     "Too many message codes (see CONFIG_FWK_WIDE_IDS)");
 
 
 #ifdef __cplusplus
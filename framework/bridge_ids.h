@@ -0,0 +1 @@
+	FWK_ID_BRIDGE,
@@ -16,12 +16,176 @@ extern "C" {
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
-#include <zephyr/kernel.h>
+#include "FrameworkOs.h"
 #include <stddef.h>
 
 /******************************************************************************/
-/* Global Function Prototypes                                                 */
+/* Global Constants, Macros and Type Definitions                              */
 /******************************************************************************/
+/* Each buffer is preceded by a header.  The layout is public so that
+ * the size of statically allocated blocks can be computed at build time.
+ */
+struct bph {
+#if defined(CONFIG_BUFFER_POOL_CHECK_DOUBLE_FREE) &&                           \
+	!defined(CONFIG_FWK_COMPACT_MSG)
+	void *ptr;
+#endif
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+	uint16_t owner; /** framework ID charged for the buffer */
+#endif
+	uint16_t size;
+	uint8_t pool;
+	/* Double free marker in compact layout, canary in integrity mode */
+	uint8_t reserved;
+} __packed;
+
+#define BP_HEADER_SIZE sizeof(struct bph)
+
+/* Largest block (buffer and overhead) because the size is 16 bits */
+#define BP_SIZE_MAX UINT16_MAX
+
+/* Value of reserved while a buffer is taken (compact layout) */
+#define BP_MARKER_TAKEN 0xA5
+
+/* Bytes per block saved by the compact layout */
+#if defined(CONFIG_BUFFER_POOL_CHECK_DOUBLE_FREE) &&                           \
+	defined(CONFIG_FWK_COMPACT_MSG)
+#define BP_HEADER_SAVED sizeof(void *)
+#else
+#define BP_HEADER_SAVED ((size_t)0)
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+/* Starts the block so that the list node is aligned.  The padding of an
+ * aligned take is between the track and the header.
+ */
+struct bp_track {
+	sys_dnode_t node;
+	uint32_t take_ms;
+	uint16_t site;
+	uint16_t pad;
+};
+
+#define BP_TRACK_SIZE sizeof(struct bp_track)
+#else
+#define BP_TRACK_SIZE ((size_t)0)
+#endif
+
+#define BP_BLOCK_OVERHEAD (BP_TRACK_SIZE + BP_HEADER_SIZE)
+
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+/* Follows the buffer (unaligned) */
+#define BP_GUARD 0x5AC3
+#define BP_TRAILER_SIZE sizeof(uint16_t)
+
+/* Value of freed buffers */
+#define BP_POISON 0xDB
+
+enum bp_integrity_error {
+	/* Canary is wrong (underflow or free of a buffer that wasn't taken) */
+	BP_INTEGRITY_BAD_HEADER = 0,
+	BP_INTEGRITY_DOUBLE_FREE,
+	/* Trailing guard is wrong */
+	BP_INTEGRITY_OVERFLOW,
+	/* Buffer was written after it was freed */
+	BP_INTEGRITY_USE_AFTER_FREE,
+};
+#else
+#define BP_TRAILER_SIZE 0
+#endif
+
+/* Pool 0 is the heap.  Type pools start at 1. */
+#define BP_HEAP_POOL 0
+
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+/* Heap blocks taken with an alignment.  The number of padding bytes
+ * is stored in the byte that precedes the header.
+ */
+#define BP_ALIGNED_POOL UINT8_MAX
+
+/* The padding must fit in one byte */
+#define BP_ALIGN_MAX 128
+
+/* Take a message of type t whose buffer[] starts on a multiple of a */
+#define BP_TRY_TO_TAKE_ALIGNED_MSG(t, s, a)                                    \
+	((t *)BufferPool_TryToTakeAligned(sizeof(t) + (s), a,                  \
+					  offsetof(t, buffer), __func__))
+#endif
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+/* Type pools are generated from FWK_TYPE_POOL(type, count) declarations
+ * in the framework type files.  Each pool is a memory slab that holds
+ * count messages of the type.
+ */
+struct bp_type_pool {
+	struct k_mem_slab *slab;
+	const char *name;
+	size_t size;
+	uint32_t count;
+};
+
+#define BP_TYPE_POOL_BLOCK_SIZE(type)                                          \
+	ROUND_UP(sizeof(type) + BP_BLOCK_OVERHEAD + BP_TRAILER_SIZE,           \
+		 sizeof(void *))
+
+/* Defined in generated file framework_pools.c */
+extern const struct bp_type_pool fwk_type_pools[];
+extern const uint8_t fwk_type_pool_count;
+
+/* Take a message from the pool of its type (O(1), doesn't use the heap) */
+#define BP_TYPE_POOL_TAKE(type)                                                \
+	((type *)BufferPool_TryToTakeFromPool(FWK_TYPE_POOL_ID_##type,         \
+					      sizeof(type), K_NO_WAIT,         \
+					      __func__))
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+/* Pressure level of the heap (from watermarks on remaining space) */
+enum bp_pressure {
+	BP_PRESSURE_NONE = 0,
+	BP_PRESSURE_LOW,
+	BP_PRESSURE_HIGH,
+};
+
+/* A take is admitted when its class is at least the pressure level */
+enum bp_class {
+	/* Rejected at low pressure (samples that can be dropped) */
+	BP_CLASS_BULK = 0,
+	/* Rejected at high pressure (BufferPool_TryToTake) */
+	BP_CLASS_NORMAL,
+	/* Only fails when the heap is exhausted (BufferPool_Take) */
+	BP_CLASS_CRITICAL,
+};
+
+/* Called when the pressure level changes.  Called from the context of
+ * the take or free (which may be an interrupt), so it must not block.  It
+ * can take or free buffers (the change is reported after it returns).
+ */
+struct bp_pressure_callback {
+	sys_snode_t node;
+	void (*handler)(enum bp_pressure level, void *user_data);
+	void *user_data;
+};
+
+#define BP_TRY_TO_TAKE_CLASS(s, c)                                             \
+	BufferPool_TryToTakeClass(s, c, K_NO_WAIT, __func__)
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+/* Buffers taken without an ID aren't charged */
+#define BP_OWNER_NONE UINT16_MAX
+
+/* Bytes include the buffer pool overhead */
+struct bp_quota_stats {
+	uint32_t quota; /** 0 for no limit */
+	uint32_t used;
+	uint32_t peak;
+	uint32_t failures;
+};
+
+#define BP_TRY_TO_TAKE_ID(s, id) BufferPool_TryToTakeId(s, id, __func__)
+#endif
+
 struct bp_stats {
 	bool initialized;
 	int space_available;
@@ -33,12 +197,47 @@ struct bp_stats {
 	int max_allocs;
 	int take_failures;
 	int last_fail_size;
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+	int rejections; /** takes rejected because of pressure */
+#endif
+#ifdef CONFIG_BUFFER_POOL_HEAP_STATS
+	/* Heap values include headers and chunk overhead */
+	size_t heap_free;
+	size_t heap_used;
+	size_t heap_max_used;
+	/* Free lists (power of two size classes) that have chunks */
+	size_t free_lists;
+	/* Lower bound if the largest list has more chunks than are scanned */
+	size_t largest_free_chunk;
+	/* Largest size that can currently be taken */
+	size_t largest_take;
+	/* 0 when all free space is contiguous */
+	int fragmentation_percent;
+#endif
 #if CONFIG_BUFFER_POOL_WINDOW_SIZE > 0
 	size_t windex;
 	uint16_t window[CONFIG_BUFFER_POOL_WINDOW_SIZE];
 #endif
 };
 
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+struct bp_site_stats {
+	const char *context;
+	uint32_t live_bytes;
+	uint32_t live_count;
+	uint32_t peak_bytes;
+	uint32_t peak_count;
+	uint32_t total_allocs;
+};
+
+struct bp_aged_buffer {
+	const char *context;
+	void *buffer;
+	size_t size;
+	uint32_t age_ms;
+};
+#endif
+
 #define BP_CONTEXT_UNUSED "NA"
 
 #define BP_TRY_TO_TAKE(s) BufferPool_TryToTake(s, __func__)
@@ -65,6 +264,86 @@ void BufferPool_Initialize(void);
 void *BufferPool_TryToTakeTimeout(size_t size, k_timeout_t timeout,
 				  const char *const context);
 
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+/**
+ * @brief Same as BufferPool_TryToTakeTimeout except that the take is
+ * rejected (without waiting) when the pressure level is above its class.
+ * BufferPool_TryToTake uses BP_CLASS_NORMAL and BufferPool_Take uses
+ * BP_CLASS_CRITICAL.
+ */
+void *BufferPool_TryToTakeClass(size_t size, enum bp_class cls,
+				k_timeout_t timeout, const char *const context);
+
+enum bp_pressure BufferPool_GetPressure(void);
+
+/**
+ * @brief Add a callback that is called when the pressure level changes.
+ * The callback must remain valid (it is added to a list).
+ */
+void BufferPool_AddPressureCallback(struct bp_pressure_callback *callback);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+/**
+ * @brief Allocate a buffer that is charged to a framework ID (FwkId_t)
+ * until it is freed.  Fails without waiting when the take would exceed the
+ * quota of the ID.
+ */
+void *BufferPool_TryToTakeId(size_t size, uint16_t id,
+			     const char *const context);
+
+/**
+ * @brief Set the maximum number of bytes that can be charged to an ID.
+ *
+ * @param quota 0 for no limit
+ *
+ * @retval 0 on success, -EINVAL if the ID is too large
+ */
+int BufferPool_SetQuota(uint16_t id, uint32_t quota);
+
+/**
+ * @retval 0 on success, -EINVAL if the ID is too large
+ */
+int BufferPool_GetQuotaStats(uint16_t id, struct bp_quota_stats *stats);
+
+/**
+ * @retval number of IDs that can have a quota
+ */
+uint16_t BufferPool_GetQuotaIds(void);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+/**
+ * @brief Allocates a buffer of at least size bytes whose address plus
+ * offset is a multiple of align.  The buffer is set to zero.
+ * This function won't assert if a buffer can't be taken.
+ *
+ * @param align power of two that isn't larger than BP_ALIGN_MAX
+ * @param offset of the aligned member (0 to align the buffer itself)
+ * @param context for printing warning when buffer can't be allocated
+ * @return void*
+ */
+void *BufferPool_TryToTakeAligned(size_t size, size_t align, size_t offset,
+				  const char *const context);
+#endif
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+/**
+ * @brief Waits up to timeout to allocate a buffer from a type pool.
+ * The buffer is set to zero.  BufferPool_Free returns it to its pool.
+ * This function won't assert if the pool is empty.
+ *
+ * @param pool FWK_TYPE_POOL_ID_<type> (BP_HEAP_POOL uses the heap)
+ * @param size in bytes (must not be larger than the type)
+ * @param timeout zephyr timeout
+ * @param context for printing warning when buffer can't be allocated
+ * @return void*
+ */
+void *BufferPool_TryToTakeFromPool(uint8_t pool, size_t size,
+				   k_timeout_t timeout,
+				   const char *const context);
+#endif
+
 /**
  * @brief Allocates a buffer of at least size bytes and returns a pointer.
  * The buffer is set to zero.
@@ -88,6 +367,15 @@ void *BufferPool_Take(size_t size);
  */
 void BufferPool_Free(void *pBuffer);
 
+/**
+ * @brief Get the size that was requested when a buffer was taken.
+ *
+ * @param pBuffer pointer returned by a take function
+ *
+ * @return size in bytes (0 if pBuffer is NULL)
+ */
+size_t BufferPool_GetSize(const void *pBuffer);
+
 /**
  * @brief Get pointer to buffer pool statistics
  *
@@ -98,6 +386,52 @@ void BufferPool_Free(void *pBuffer);
  */
 int BufferPool_GetStats(uint8_t index, struct bp_stats *stats);
 
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+/**
+ * @brief Get the statistics of an allocation site (take context).
+ * Sites are added in the order they first allocate.  When the table is
+ * full, the remaining sites are combined into the last entry.
+ *
+ * @param index of site
+ * @param stats pointer to stats that will be copied into by this function.
+ *
+ * @return 0 on success, -ENOENT if index isn't in use
+ */
+int BufferPool_GetSiteStats(uint8_t index, struct bp_site_stats *stats);
+
+/**
+ * @brief Get the buffers that have been allocated for at least min_age_ms
+ * (oldest first).  Useful for finding buffers that were leaked or are held
+ * using DISPATCH_DO_NOT_FREE.
+ *
+ * @param min_age_ms age threshold
+ * @param list array that is filled in by this function
+ * @param max number of entries in list
+ *
+ * @return number of entries filled in
+ */
+size_t BufferPool_GetAgedBuffers(uint32_t min_age_ms,
+				 struct bp_aged_buffer *list, size_t max);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+/**
+ * @brief Called when a check fails.  The default implementation logs an
+ * error.  The buffer isn't returned to the pool when the header is bad.
+ * A double free is only found reliably while the buffer is in quarantine.
+ * Once a block is returned to the heap (or a type pool), the allocator
+ * keeps its free list at the start of the block, which can overwrite the
+ * canary, so a later double free may be reported as a bad header.
+ *
+ * @param context of the take when CONFIG_BUFFER_POOL_SITE_STATS is
+ * enabled and the header is good, otherwise the name of the pool that
+ * holds the buffer ("heap" or the type).  The context isn't stored in
+ * the header.
+ */
+void BufferPool_IntegrityHandler(enum bp_integrity_error error,
+				 void *buffer, const char *context);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
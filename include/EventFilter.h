@@ -0,0 +1,101 @@
+/**
+ * @file EventFilter.h
+ * @brief Event filter receiver for untargeted framework messages.
+ *
+ * When CONFIG_FILTER is enabled, FwkMsg_FilteredTargetedSend sends messages
+ * without a target to FWK_ID_EVENT_FILTER.  The built-in filter applies the
+ * rule configured for the message code and broadcasts the messages that
+ * survive.  Message codes without a rule are broadcast unchanged.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __EVENT_FILTER_H__
+#define __EVENT_FILTER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+enum EventFilterTypeBitmask {
+	EVENT_FILTER_NONE = 0,
+	/* Drop messages that arrive within debounceMs of the previous one
+	 * (a message is forwarded at least every debounceMaxMs)
+	 */
+	EVENT_FILTER_DEBOUNCE = BIT(0),
+	/* Forward at most rateCount messages every ratePeriodMs */
+	EVENT_FILTER_RATE_LIMIT = BIT(1),
+	/* Forward only when the value crosses the threshold */
+	EVENT_FILTER_THRESHOLD = BIT(2),
+	/* Drop messages whose payload matches the last forwarded message */
+	EVENT_FILTER_DEDUPLICATE = BIT(3),
+};
+
+/* Rules are checked in the order debounce, deduplicate, threshold, and then
+ * rate limit so that only surviving messages count against the rate.
+ */
+typedef struct EventFilterRule {
+	FwkMsgCode_t msgCode;
+	uint8_t type; /** @ref EventFilterTypeBitmask */
+	uint16_t rateCount;
+	uint32_t ratePeriodMs;
+	uint32_t debounceMs;
+	/* Longest time a continuous stream is held by debounce (0 is
+	 * forever)
+	 */
+	uint32_t debounceMaxMs;
+	int32_t threshold;
+	/* The value must fall below (threshold - hysteresis) to re-arm */
+	int32_t hysteresis;
+	/* Required for threshold rules.  Called without the rule lock (from
+	 * the event filter thread).
+	 */
+	int32_t (*getValue)(const FwkMsg_t *pMsg);
+} EventFilterRule_t;
+
+typedef struct EventFilterStats {
+	uint32_t forwarded;
+	uint32_t dropped;
+} EventFilterStats_t;
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Add (or replace) the rule for a message code.
+ * The rule is copied.
+ *
+ * @retval 0 on success, -EINVAL if the rule is invalid,
+ * -ENOMEM if the rule table is full
+ */
+int EventFilter_AddRule(const EventFilterRule_t *pRule);
+
+/**
+ * @brief Remove the rule for a message code.  Messages with this code
+ * will be broadcast without filtering.
+ *
+ * @retval 0 on success, -ENOENT if there isn't a rule for the code
+ */
+int EventFilter_RemoveRule(FwkMsgCode_t msgCode);
+
+/**
+ * @brief Get the number of forwarded and dropped messages for a code.
+ *
+ * @retval 0 on success, -ENOENT if there isn't a rule for the code
+ */
+int EventFilter_GetStats(FwkMsgCode_t msgCode, EventFilterStats_t *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EVENT_FILTER_H__ */
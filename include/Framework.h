@@ -16,7 +16,7 @@ extern "C" {
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
-#include <zephyr/kernel.h>
+#include "FrameworkOs.h"
 
 /******************************************************************************/
 /* Readability                                                                */
@@ -54,8 +54,17 @@ extern "C" {
 /* Global Constants, Macros and Type Definitions                              */
 /******************************************************************************/
 
+#ifdef CONFIG_FWK_WIDE_IDS
+typedef uint16_t FwkMsgCode_t;
+typedef uint16_t FwkId_t;
+#else
 typedef uint8_t FwkMsgCode_t;
 typedef uint8_t FwkId_t;
+#endif
+
+/* Largest message code and receiver ID */
+#define FWK_MSG_CODE_MAX ((FwkMsgCode_t)~0)
+#define FWK_ID_MAX ((FwkId_t)~0)
 
 /* Zephyr kernel queue functions use int and return 0 for success */
 #define BaseType_t int
@@ -88,8 +97,23 @@ enum FwkMsgOptionBitmask {
 	FWK_MSG_OPTION_NONE = 0,
 	/* Callback option requires the callback message type to be used */
 	FWK_MSG_OPTION_CALLBACK = BIT(0),
+	/* Payload is a chain of segments (see FrameworkSegMsg.h) */
+	FWK_MSG_OPTION_SEGMENTED = BIT(1),
+	/* Receiver thread runs at header priority until message is handled */
+	FWK_MSG_OPTION_PRIORITY = BIT(2),
+	/* Reply to a request (FwkAsyncMsg_t) */
+	FWK_MSG_OPTION_ASYNC = BIT(3),
+	/* Message holds a net_buf reference (see FrameworkNetBuf.h) */
+	FWK_MSG_OPTION_NET_BUF = BIT(4),
+	/* Set by the framework when the message raised the receiver priority */
+	FWK_MSG_OPTION_BOOSTED = BIT(5),
 };
 
+/* Options whose message contains pointers that are only valid in this image */
+#define FWK_MSG_OPTION_LOCAL_ONLY                                              \
+	(FWK_MSG_OPTION_CALLBACK | FWK_MSG_OPTION_SEGMENTED |                  \
+	 FWK_MSG_OPTION_NET_BUF)
+
 typedef enum DispatchResultEnum {
 	DISPATCH_OK = 0,
 	DISPATCH_ERROR,
@@ -101,8 +125,35 @@ typedef struct FwkMsgHeader {
 	FwkId_t rxId;
 	FwkId_t txId;
 	uint8_t options;
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	int8_t priority; /** thread priority (FWK_MSG_OPTION_PRIORITY) */
+#ifndef CONFIG_FWK_WIDE_IDS
+	uint8_t reserved;
+#endif
+#elif defined(CONFIG_FWK_WIDE_IDS)
+	uint8_t reserved;
+#endif
+#ifdef CONFIG_FWK_LIVENESS
+	uint32_t queuedMs; /** uptime when queued (set by the framework) */
+#endif
 } FwkMsgHeader_t;
-BUILD_ASSERT(sizeof(FwkMsgHeader_t) == 4, "Unexpected Header Size");
+
+#ifdef CONFIG_FWK_WIDE_IDS
+#define FWK_MSG_HEADER_ID_SIZE 8
+#elif defined(CONFIG_FWK_MSG_PRIORITY)
+#define FWK_MSG_HEADER_ID_SIZE 6
+#else
+#define FWK_MSG_HEADER_ID_SIZE 4
+#endif
+
+#ifdef CONFIG_FWK_LIVENESS
+/* The enqueue time is aligned */
+#define FWK_MSG_HEADER_SIZE (ROUND_UP(FWK_MSG_HEADER_ID_SIZE, 4) + 4)
+#else
+#define FWK_MSG_HEADER_SIZE FWK_MSG_HEADER_ID_SIZE
+#endif
+BUILD_ASSERT(sizeof(FwkMsgHeader_t) == FWK_MSG_HEADER_SIZE,
+	     "Unexpected Header Size");
 
 typedef struct FwkMsg {
 	FwkMsgHeader_t header;
@@ -110,10 +161,22 @@ typedef struct FwkMsg {
 } FwkMsg_t;
 
 /* A generic framework message with a buffer */
+#ifdef CONFIG_FWK_COMPACT_MSG
+/* The buffer pool limits an allocation to 16 bits */
+typedef uint16_t FwkBufSize_t;
+#else
+typedef size_t FwkBufSize_t;
+#endif
+
+/* The compact layout doesn't store the size (it is derived from the
+ * buffer pool header).  Use FWK_BUF_MSG_BUFFER_SIZE to read it.
+ */
 typedef struct FwkBufMsg {
 	FwkMsgHeader_t header;
-	size_t size; /** number of bytes allocated for buffer */
-	size_t length; /** number of used bytes in buffer */
+#ifndef CONFIG_FWK_COMPACT_MSG
+	FwkBufSize_t size; /** number of bytes allocated for buffer */
+#endif
+	FwkBufSize_t length; /** number of used bytes in buffer */
 	uint8_t buffer[]; /** size is determined by allocator */
 } FwkBufMsg_t;
 
@@ -146,12 +209,49 @@ typedef DispatchResult_t FwkMsgHandler_t(FwkMsgReceiver_t *pMsgRxer,
  */
 typedef struct k_msgq FwkQueue_t;
 
+#ifdef CONFIG_FWK_SCRATCH
+/* Bump allocator for handler temporaries (see Framework_ScratchAlloc) */
+typedef struct FwkScratch {
+	uint8_t *pBase;
+	size_t size;
+	size_t used;
+	size_t peak; /** largest use by one message */
+} FwkScratch_t;
+
+#define FWK_SCRATCH_ALIGN 8
+
+#define FWK_SCRATCH_DEFINE(n, s)                                               \
+	static uint8_t __aligned(FWK_SCRATCH_ALIGN) n##_buf[s];                \
+	static FwkScratch_t n = { .pBase = n##_buf, .size = (s) }
+#endif
+
 struct FwkMsgReceiver {
 	FwkId_t id;
 	FwkQueue_t *pQueue;
 	TickType_t rxBlockTicks;
 	FwkMsgHandler_t *(*pMsgDispatcher)(FwkMsgCode_t msgCode);
 	bool (*acceptBroadcast)(const FwkMsg_t *pMsg);
+#ifdef CONFIG_FWK_WORK_RECEIVER
+	/* Set by Framework_RegisterWorkReceiver */
+	struct k_work *pWork;
+#endif
+#ifdef CONFIG_FWK_SCRATCH
+	FwkScratch_t *pScratch; /** optional */
+#endif
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	/* Set by the framework (Framework_MsgReceiver) */
+	atomic_ptr_t tid;
+	int basePriority;
+	int boostPriority;
+	uint32_t boosted; /** number of queued priority messages */
+#endif
+#ifdef CONFIG_FWK_LIVENESS
+	/* Set by the framework */
+	atomic_t progress; /** messages received */
+	atomic_t waitingMs; /** queuedMs of the head of the queue, 0 if empty */
+	/* Used by the liveness monitor */
+	uint32_t lastProgress;
+#endif
 };
 
 /**
@@ -168,6 +268,19 @@ typedef struct FwkMsgTask {
 	TickType_t timerPeriodTicks; /* Second time (0 for one shot) */
 } FwkMsgTask_t;
 
+#ifdef CONFIG_FWK_WORK_RECEIVER
+/**
+ * @brief Message Framework Work Receiver Object
+ *
+ * A receiver without a thread.  Its messages are dispatched on a work
+ * queue that is shared by all work receivers.
+ */
+typedef struct FwkWorkReceiver {
+	FwkMsgReceiver_t rxer;
+	struct k_work work;
+} FwkWorkReceiver_t;
+#endif
+
 /**
  * @brief Get pointer to object containing task (in dispatcher context).
  *
@@ -182,6 +295,23 @@ typedef struct FwkMsgTask {
 
 #define FWK_BUFFER_MSG_SIZE(t, s) (sizeof(t) + (s))
 
+/* Bytes allocated for the buffer of a FwkBufMsg_t (p).  In the compact
+ * layout the message must have been taken from the buffer pool.
+ */
+#ifdef CONFIG_FWK_COMPACT_MSG
+#define FWK_BUF_MSG_BUFFER_SIZE(p)                                             \
+	(BufferPool_GetSize(p) - sizeof(FwkBufMsg_t))
+#else
+#define FWK_BUF_MSG_BUFFER_SIZE(p) ((size_t)(p)->size)
+#endif
+
+/* Declares the maximum number of messages of a type that can be in flight.
+ * When CONFIG_FWK_TYPE_POOLS is enabled, a pool is generated for each
+ * declaration in a framework type file.
+ * Example (after the typedef): FWK_TYPE_POOL(ResetMsg_t, 2)
+ */
+#define FWK_TYPE_POOL(type, count)
+
 /* Most framework messages are small.  This is a check that at least
  * one message can be allocated in addition to small messages.
  */
@@ -204,10 +334,10 @@ typedef struct FwkMsgTask {
 /**
  * @brief This function registers a Message Task or Receiver with the
  * Message Framework.  This is necessary to support routing of
- * messages. A critical section is entered when a task is
- * registered.  However, the task should be registered before the
- * task is created so that the periodic timer can be created before
- * the task starts.
+ * messages. The registry is updated atomically (it is safe to
+ * register while messages are being sent).  However, the task should be
+ * registered before the task is created so that the periodic timer can be
+ * created before the task starts.
  *
  * @param pMsgRxer A message receiver.
  * @param pMsgTask Pointer to a Message Task (which contains a rxer).
@@ -220,6 +350,38 @@ typedef struct FwkMsgTask {
 void Framework_RegisterReceiver(FwkMsgReceiver_t *pRxer);
 void Framework_RegisterTask(FwkMsgTask_t *pMsgTask);
 
+#ifdef CONFIG_FWK_WORK_RECEIVER
+/**
+ * @brief Registers a receiver whose messages are dispatched on the shared
+ * framework work queue (instead of by its own thread).  Handlers of one
+ * receiver are never run concurrently.  rxBlockTicks isn't used.
+ *
+ * @note Messages must be sent with the router (Framework_Send, Unicast,
+ * or Broadcast).  Messages placed directly on the queue with
+ * Framework_Queue aren't dispatched until the next routed message.
+ * Handlers must not block for long because they delay other receivers.
+ */
+void Framework_RegisterWorkReceiver(FwkWorkReceiver_t *pWorkRxer);
+#endif
+
+/**
+ * @brief Removes a receiver from the registry so that its ID can be
+ * registered again (for example, when a device is powered down).
+ * Messages sent after this returns aren't routed to the receiver.
+ * Messages that were already queued are freed.
+ *
+ * @note Must not be called from an interrupt.  The receiver must not be
+ * receiving messages (call from the receiver's thread or after it has
+ * stopped).  The task version also stops the periodic timer.
+ *
+ * @retval Number of messages that were freed, -ENOENT if the receiver
+ * isn't registered, -EINVAL if the receiver is invalid, -ETIMEDOUT if a
+ * sender still referenced the receiver after
+ * CONFIG_FWK_UNREGISTER_TIMEOUT_MS (the receiver is still registered)
+ */
+int Framework_UnregisterReceiver(FwkMsgReceiver_t *pRxer);
+int Framework_UnregisterTask(FwkMsgTask_t *pMsgTask);
+
 /**
  * @brief Wraps the queue receive function of the OS and waits for
  * rxBlockTicks for a message to arrive in a task's queue.
@@ -228,6 +390,30 @@ void Framework_RegisterTask(FwkMsgTask_t *pMsgTask);
  */
 void Framework_MsgReceiver(FwkMsgReceiver_t *pMsgRxer);
 
+/**
+ * @brief Calls the handler for a message that has been removed from
+ * a receiver's queue and then frees the message (unless the handler
+ * returns DISPATCH_DO_NOT_FREE).
+ *
+ * @note Used by Framework_MsgReceiver and work receivers.
+ */
+void Framework_DispatchMsg(FwkMsgReceiver_t *pRxer, FwkMsg_t *pMsg);
+
+#ifdef CONFIG_FWK_SCRATCH
+/**
+ * @brief Allocates a temporary buffer from the scratch arena of a
+ * receiver.  The buffer isn't set to zero.  Everything allocated is
+ * released after the message (or continuation) has been handled, so the
+ * buffer must not be referenced by a message that is kept or sent.
+ *
+ * @note Must be called in the context of pRxer.
+ *
+ * @retval pointer (aligned to FWK_SCRATCH_ALIGN) or NULL if the receiver
+ * doesn't have an arena or there isn't enough space
+ */
+void *Framework_ScratchAlloc(FwkMsgReceiver_t *pRxer, size_t Size);
+#endif
+
 /**
  * @brief Sends a message to a single task based on a task ID.
  *
@@ -275,6 +461,18 @@ BaseType_t Framework_Queue(FwkQueue_t *pQueue, void *ppData,
  */
 BaseType_t Framework_QueueIsEmpty(FwkId_t RxId);
 
+/**
+ * @brief Called for each registered receiver.
+ *
+ * @note The receiver can't be unregistered until the function returns
+ * so it must not block.
+ */
+typedef void (*FwkReceiverIterator_t)(FwkMsgReceiver_t *pRxer,
+				      void *pContext);
+
+void Framework_ForEachReceiver(FwkReceiverIterator_t Iterator,
+			       void *pContext);
+
 /**
  * @brief Free all messages in a receiver's queue.
  *
@@ -297,6 +495,16 @@ size_t Framework_Flush(FwkId_t RxId);
  */
 BaseType_t Framework_Receive(FwkQueue_t *pQueue, void *ppData,
 			     TickType_t BlockTicks);
+/**
+ * @brief Returns a message to the buffer pool.
+ * Anything that the message owns (such as a segment chain or a net_buf
+ * reference) is also freed.
+ *
+ * @note Framework_MsgReceiver calls this unless a handler returns
+ * DISPATCH_DO_NOT_FREE.
+ */
+void Framework_FreeMsg(FwkMsg_t *pMsg);
+
 /**
  * @brief Starts a task's periodic timer
  */
@@ -0,0 +1,312 @@
+/**
+ * @file Framework.hpp
+ * @brief Typed C++17 layer for the message framework.
+ *
+ * fwk::Msg<T> owns a message.  It can't be copied and frees the message
+ * (Framework_FreeMsg) when it goes out of scope, so a message that wasn't
+ * sent or kept can't leak.  The send functions take the message by value,
+ * so the caller must give up ownership with std::move.  The message is
+ * freed when it can't be sent.
+ *
+ * fwk::Receiver generates the dispatcher of a receiver from the message
+ * codes that it handles.  The message type of each code is declared with
+ * FWK_MSG_TYPE.
+ *
+ * This header doesn't have a source file and doesn't change the C API.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_HPP__
+#define __FRAMEWORK_HPP__
+
+#if __cplusplus < 201703L
+#error "Framework.hpp requires C++17"
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "BufferPool.h"
+#include "Framework.h"
+#include "FrameworkMsg.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+namespace fwk
+{
+/* Message type of a code.  Codes without a declaration use FwkMsg_t. */
+template <FwkMsgCode_t Code> struct MsgType {
+	using type = FwkMsg_t;
+};
+
+template <FwkMsgCode_t Code> using MsgType_t = typename MsgType<Code>::type;
+
+/* Messages are plain C structures that start with the header */
+template <typename T> constexpr bool IsMsg()
+{
+	return std::is_standard_layout_v<T> &&
+	       std::is_trivially_copyable_v<T> &&
+	       std::is_same_v<decltype(T::header), FwkMsgHeader_t> &&
+	       offsetof(T, header) == 0;
+}
+
+/**
+ * @brief Move-only owner of a message.
+ */
+template <typename T> class Msg {
+	static_assert(IsMsg<T>(), "Message must be a C message structure");
+
+    public:
+	Msg() noexcept = default;
+
+	/* Takes ownership of p */
+	explicit Msg(T *p) noexcept : ptr(p)
+	{
+	}
+
+	Msg(const Msg &) = delete;
+	Msg &operator=(const Msg &) = delete;
+
+	Msg(Msg &&other) noexcept : ptr(other.release())
+	{
+	}
+
+	Msg &operator=(Msg &&other) noexcept
+	{
+		reset(other.release());
+		return *this;
+	}
+
+	~Msg()
+	{
+		reset();
+	}
+
+	T *get() const noexcept
+	{
+		return ptr;
+	}
+
+	T *operator->() const noexcept
+	{
+		return ptr;
+	}
+
+	T &operator*() const noexcept
+	{
+		return *ptr;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return ptr != nullptr;
+	}
+
+	/* Gives up ownership without freeing the message */
+	T *release() noexcept
+	{
+		return std::exchange(ptr, nullptr);
+	}
+
+	/* Frees anything that the message owns (segments, net_buf) */
+	void reset(T *p = nullptr) noexcept
+	{
+		T *old = std::exchange(ptr, p);
+
+		if (old != nullptr) {
+			Framework_FreeMsg(reinterpret_cast<FwkMsg_t *>(old));
+		}
+	}
+
+	FwkMsg_t *raw() const noexcept
+	{
+		return reinterpret_cast<FwkMsg_t *>(ptr);
+	}
+
+    private:
+	T *ptr = nullptr;
+};
+
+/**
+ * @brief Takes a message from the buffer pool and initializes its header.
+ *
+ * @param extra bytes after the structure (the buffer of a FwkBufMsg_t)
+ *
+ * @retval empty message if it couldn't be allocated
+ */
+template <typename T>
+Msg<T> Take(FwkId_t TxId, FwkMsgCode_t Code, size_t extra = 0) noexcept
+{
+	static_assert(IsMsg<T>(), "Message must be a C message structure");
+
+	T *p = static_cast<T *>(
+		BufferPool_TryToTake(sizeof(T) + extra, "fwk::Take"));
+
+	if (p != nullptr) {
+		FRAMEWORK_MSG_HEADER_INIT(p, Code, TxId);
+	}
+
+	return Msg<T>(p);
+}
+
+/**
+ * @brief Framework_Send that always takes ownership.
+ *
+ * Example: fwk::Send(FWK_ID_CLOUD, std::move(msg));
+ */
+template <typename T> BaseType_t Send(FwkId_t RxId, Msg<T> msg) noexcept
+{
+	if (!msg) {
+		return FWK_ERROR;
+	}
+
+	BaseType_t result = Framework_Send(RxId, msg.raw());
+
+	if (result == FWK_SUCCESS) {
+		msg.release();
+	}
+
+	return result;
+}
+
+/**
+ * @brief Framework_Unicast that always takes ownership.
+ */
+template <typename T> BaseType_t Unicast(Msg<T> msg) noexcept
+{
+	if (!msg) {
+		return FWK_ERROR;
+	}
+
+	BaseType_t result = Framework_Unicast(msg.raw());
+
+	if (result == FWK_SUCCESS) {
+		msg.release();
+	}
+
+	return result;
+}
+
+/**
+ * @brief Framework_Broadcast that always takes ownership.  The size of the
+ * copies is the size that was taken (including any extra bytes).
+ */
+template <typename T> BaseType_t Broadcast(Msg<T> msg) noexcept
+{
+	if (!msg) {
+		return FWK_ERROR;
+	}
+
+	BaseType_t result =
+		Framework_Broadcast(msg.raw(), BufferPool_GetSize(msg.get()));
+
+	if (result == FWK_SUCCESS) {
+		msg.release();
+	}
+
+	return result;
+}
+
+/**
+ * @brief Receiver whose dispatcher is generated from Codes.
+ *
+ * Derived must have a member function template that is specialized
+ * (or overloaded with if constexpr) for each code:
+ *
+ * template <FwkMsgCode_t Code>
+ * DispatchResult_t Handle(fwk::Msg<fwk::MsgType_t<Code>> &msg);
+ *
+ * The handler keeps a message by moving it (for example to fwk::Send).
+ * A message that is still owned when the handler returns is freed.
+ * The dispatcher compares the code with each of Codes, which the compiler
+ * can turn into the same code as a case statement.
+ */
+template <typename Derived, FwkMsgCode_t... Codes> class Receiver {
+    public:
+	explicit Receiver(FwkId_t Id, FwkQueue_t *pQueue) noexcept : rxer{}
+	{
+		rxer.id = Id;
+		rxer.pQueue = pQueue;
+		rxer.rxBlockTicks = K_FOREVER;
+		rxer.pMsgDispatcher = Dispatcher;
+	}
+
+	Receiver(const Receiver &) = delete;
+	Receiver &operator=(const Receiver &) = delete;
+
+	FwkMsgReceiver_t *Rxer() noexcept
+	{
+		return &rxer;
+	}
+
+	static FwkMsgHandler_t *Dispatcher(FwkMsgCode_t Code) noexcept
+	{
+		FwkMsgHandler_t *handler = nullptr;
+
+		(void)((Code == Codes && (handler = Thunk<Codes>, true)) ||
+		       ...);
+
+		return handler;
+	}
+
+    private:
+	/* The receiver is the first (and only) member, see Self */
+	FwkMsgReceiver_t rxer;
+
+	/* The receiver is converted to this object (offset 0 in a standard
+	 * layout class) and static_cast adjusts for the position of this
+	 * base in Derived (which doesn't have to be its first base).
+	 */
+	static Derived &Self(FwkMsgReceiver_t *pRxer) noexcept
+	{
+		static_assert(std::is_standard_layout_v<Receiver>,
+			      "Receiver must be standard layout");
+		static_assert(offsetof(Receiver, rxer) == 0,
+			      "Receiver must start with the receiver");
+		static_assert(std::is_base_of_v<Receiver, Derived>,
+			      "Derived must derive from Receiver");
+
+		return *static_cast<Derived *>(
+			reinterpret_cast<Receiver *>(pRxer));
+	}
+
+	template <FwkMsgCode_t Code>
+	static DispatchResult_t Thunk(FwkMsgReceiver_t *pRxer, FwkMsg_t *pMsg)
+	{
+		Msg<MsgType_t<Code> > msg(
+			reinterpret_cast<MsgType_t<Code> *>(pMsg));
+		DispatchResult_t result =
+			Self(pRxer).template Handle<Code>(msg);
+
+		/* Moved by the handler */
+		if (!msg) {
+			return DISPATCH_DO_NOT_FREE;
+		}
+
+		/* The framework frees the message */
+		msg.release();
+		return (result == DISPATCH_DO_NOT_FREE) ? DISPATCH_OK : result;
+	}
+};
+
+} // namespace fwk
+
+/* Declares the message type of a code (at global scope).
+ * Example: FWK_MSG_TYPE(FMC_SENSOR_EVENT, SensorEventMsg_t)
+ */
+#define FWK_MSG_TYPE(c, t)                                                     \
+	namespace fwk                                                          \
+	{                                                                      \
+	template <> struct MsgType<(c)> {                                      \
+		using type = t;                                                \
+	};                                                                     \
+	}
+
+#endif /* __FRAMEWORK_HPP__ */
@@ -0,0 +1,100 @@
+/**
+ * @file FrameworkAsync.h
+ * @brief Requests that resume a continuation when the reply arrives.
+ *
+ * A handler that needs a reply from another task sends the request with
+ * FwkAsync_Request and returns.  The receiver continues to process other
+ * messages.  When the reply (with the same correlation ID) is dispatched
+ * to the receiver, the continuation is called instead of the handler for
+ * the reply's message code.  The frame pointer holds the state of the
+ * operation (it usually points to a static state machine structure).
+ *
+ * A request that isn't answered before its timeout expires calls the
+ * continuation with a NULL reply.  Each request has a timer that sends
+ * the receiver a message (with correlation ID 0) when the timeout expires
+ * so that a receiver without other traffic doesn't wait forever.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_ASYNC_H__
+#define __FRAMEWORK_ASYNC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Requests and replies start with this structure */
+typedef struct FwkAsyncMsg {
+	FwkMsgHeader_t header;
+	uint32_t correlationId;
+} FwkAsyncMsg_t;
+
+/**
+ * @brief Called in the context of the receiver that made the request.
+ *
+ * @param pReply NULL if the request timed out
+ *
+ * @retval DISPATCH_DO_NOT_FREE to keep the reply
+ */
+typedef DispatchResult_t (*FwkContinuation_t)(FwkMsgReceiver_t *pRxer,
+					      FwkMsg_t *pReply, void *pFrame);
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Send a request and store a continuation for the reply.
+ * The tx ID of the request is set to the receiver's ID.
+ *
+ * @note Must be called in the context of pRxer (from a handler or
+ * continuation).  The request is freed if it can't be sent.
+ *
+ * @param Timeout relative or absolute (K_FOREVER never expires)
+ *
+ * @retval 0 on success, -ENOMEM if too many requests are pending,
+ * -EIO if the request couldn't be sent
+ */
+int FwkAsync_Request(FwkMsgReceiver_t *pRxer, FwkId_t RxId,
+		     FwkAsyncMsg_t *pRequest, FwkContinuation_t Continuation,
+		     void *pFrame, k_timeout_t Timeout);
+
+/**
+ * @brief Send the reply to a request.  The IDs and correlation ID are
+ * set from the request.  The reply is freed if it can't be sent.
+ *
+ * @retval FWK_SUCCESS or FWK_ERROR
+ */
+BaseType_t FwkAsync_Reply(const FwkAsyncMsg_t *pRequest,
+			  FwkAsyncMsg_t *pReply);
+
+/**
+ * @brief Called by Framework_DispatchMsg.  Calls the continuation
+ * if the message is the reply to a pending request of the receiver.
+ * A timer message is consumed (FwkAsync_Expire handles the timeout).
+ *
+ * @retval true if the continuation was called (and result is set)
+ */
+bool FwkAsync_Resume(FwkMsgReceiver_t *pRxer, FwkMsg_t *pMsg,
+		     DispatchResult_t *pResult);
+
+/**
+ * @brief Called by Framework_DispatchMsg after each message.  Calls the
+ * continuation of each request of the receiver that timed out.
+ */
+void FwkAsync_Expire(FwkMsgReceiver_t *pRxer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_ASYNC_H__ */
@@ -0,0 +1,151 @@
+/**
+ * @file FrameworkBridge.h
+ * @brief Bridges framework messages to another processor.
+ *
+ * Messages with a route are sent to FWK_ID_BRIDGE (by ID, unicast, or
+ * broadcast).  The bridge serializes them into frames and passes each frame
+ * to a transport (UART, IPC, or a pipe when testing with native_sim).
+ * Bytes received by the transport are given to FwkBridge_RxBytes.  Each
+ * message in a valid frame is sent to the receiver ID from the route on the
+ * other side.  The tx ID of an injected message is FWK_ID_BRIDGE so that
+ * replies are sent back over the bridge.
+ *
+ * Frame: 0xA5 | length (varint) | records | CRC-16/CCITT of records
+ * Record: kind | code (varint) | rx ID (varint) | length (varint) | payload
+ *
+ * The wire format is little-endian.  A raw payload is the memory of the
+ * message after the header, so raw messages must be __packed types (no
+ * padding that depends on the compiler) and raw routes are only accepted
+ * on little-endian processors.  A raw message is only injected when the
+ * receiving side has added its code with the same payload size
+ * (FwkBridge_AddRawType).
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_BRIDGE_H__
+#define __FRAMEWORK_BRIDGE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+enum FwkBridgeKind {
+	/* Payload is everything after the header (__packed fixed size
+	 * messages, see FWK_BRIDGE_RAW_ROUTE_DEFINE)
+	 */
+	FWK_BRIDGE_KIND_RAW = 0,
+	/* Message is a FwkBufMsg_t, only the used part of the buffer is sent */
+	FWK_BRIDGE_KIND_BUFFER,
+};
+
+typedef struct FwkBridgeRoute {
+	FwkMsgCode_t msgCode;
+	/* Receiver on the other side, FWK_ID_RESERVED to broadcast */
+	FwkId_t remoteRxId;
+	uint8_t kind; /** @ref FwkBridgeKind */
+	/* Payload bytes of a raw message (messages of another size are
+	 * dropped), not used by other kinds
+	 */
+	uint16_t rawSize;
+} FwkBridgeRoute_t;
+
+/* Payload bytes of a raw message type */
+#define FWK_BRIDGE_RAW_SIZE(type) (sizeof(type) - sizeof(FwkMsgHeader_t))
+
+/**
+ * @brief Define a raw route for a message type.  The type must be
+ * __packed so that its layout is the same on both processors.
+ */
+#define FWK_BRIDGE_RAW_ROUTE_DEFINE(name, code, rx_id, type)                   \
+	BUILD_ASSERT(__alignof__(type) == 1,                                   \
+		     #type " must be __packed to be bridged");                 \
+	static const FwkBridgeRoute_t name = {                                 \
+		.msgCode = (code),                                             \
+		.remoteRxId = (rx_id),                                         \
+		.kind = FWK_BRIDGE_KIND_RAW,                                   \
+		.rawSize = FWK_BRIDGE_RAW_SIZE(type),                          \
+	}
+
+/**
+ * @brief Writes a frame to the transport.
+ *
+ * @retval 0 on success
+ */
+typedef int (*FwkBridgeTransport_t)(const uint8_t *pData, size_t Length,
+				    void *pContext);
+
+typedef struct FwkBridgeStats {
+	uint32_t msgsSent;
+	uint32_t framesSent;
+	uint32_t sendErrors;
+	/* Messages that are too large or contain local pointers */
+	uint32_t msgsDropped;
+	uint32_t framesReceived;
+	uint32_t framesDropped; /** CRC or length error */
+	uint32_t msgsInjected;
+	/* Invalid records (including raw messages of an unknown size) */
+	uint32_t injectErrors;
+} FwkBridgeStats_t;
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Set the transport used to send frames.
+ * Messages are dropped until a transport is set.
+ */
+void FwkBridge_SetTransport(FwkBridgeTransport_t Transport, void *pContext);
+
+/**
+ * @brief Add (or replace) the route for a message code.
+ * The route is copied.
+ *
+ * @retval 0 on success, -EINVAL if the route is invalid,
+ * -ENOMEM if the route table is full, -ENOTSUP for a raw route on a
+ * big-endian processor
+ */
+int FwkBridge_AddRoute(const FwkBridgeRoute_t *pRoute);
+
+/**
+ * @brief Remove the route for a message code.
+ *
+ * @retval 0 on success, -ENOENT if there isn't a route for the code
+ */
+int FwkBridge_RemoveRoute(FwkMsgCode_t msgCode);
+
+/**
+ * @brief Add (or replace) the payload size of received raw messages with
+ * a code.  Raw messages with a code that wasn't added or of another size
+ * aren't injected (a handler would access memory past the message).
+ *
+ * @retval 0 on success, -EINVAL if the code is invalid, -ENOMEM if the
+ * table is full, -ENOTSUP on a big-endian processor
+ */
+int FwkBridge_AddRawType(FwkMsgCode_t msgCode, uint16_t rawSize);
+
+/**
+ * @brief Parse bytes received by the transport.  Frames can be split
+ * across calls.  Messages are injected as each frame is completed.
+ *
+ * @note Must not be called from an interrupt (messages are allocated and
+ * may be broadcast).
+ */
+void FwkBridge_RxBytes(const uint8_t *pData, size_t Length);
+
+void FwkBridge_GetStats(FwkBridgeStats_t *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_BRIDGE_H__ */
@@ -0,0 +1,56 @@
+/**
+ * @file FrameworkLiveness.h
+ * @brief Detects receivers that are stalled or slow without sending
+ * messages.
+ *
+ * Each receiver counts the messages it dispatches and records when the
+ * message at the head of its queue started waiting.  The monitor checks
+ * every receiver periodically.  A receiver is stalled when a message has
+ * waited longer than the stall time and the receiver hasn't dispatched
+ * anything since the last check.  The watchdog is only fed when no receiver
+ * is stalled.  Latency limit breaches are only reported.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_LIVENESS_H__
+#define __FRAMEWORK_LIVENESS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Called by the monitor when a receiver is stalled.
+ * The default implementation logs an error.
+ *
+ * @param WaitMs time the message at the head of the queue has waited
+ */
+void FwkLiveness_StallHandler(FwkMsgReceiver_t *pRxer, uint32_t WaitMs);
+
+/**
+ * @brief Called by the monitor when a message has waited longer than the
+ * latency limit (and the receiver isn't stalled).
+ * The default implementation logs a warning.
+ */
+void FwkLiveness_LatencyHandler(FwkMsgReceiver_t *pRxer, uint32_t WaitMs);
+
+/**
+ * @retval true if no receiver was stalled at the last check
+ */
+bool FwkLiveness_Healthy(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_LIVENESS_H__ */
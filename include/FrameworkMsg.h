@@ -36,6 +36,17 @@ extern "C" {
 		p->header.options = FWK_MSG_OPTION_NONE;                       \
 	} while (0)
 
+#ifdef CONFIG_FWK_MSG_PRIORITY
+/* The receiver thread is raised to prio (if it is lower) until the message
+ * has been handled.  Requires the receiver to use Framework_MsgReceiver.
+ */
+#define FRAMEWORK_MSG_SET_PRIORITY(p, prio)                                    \
+	do {                                                                   \
+		p->header.options |= FWK_MSG_OPTION_PRIORITY;                  \
+		p->header.priority = (prio);                                   \
+	} while (0)
+#endif
+
 /******************************************************************************/
 /* Global Function Prototypes                                                 */
 /******************************************************************************/
@@ -0,0 +1,80 @@
+/**
+ * @file FrameworkNetBuf.h
+ * @brief Framework messages that carry a net_buf without copying it.
+ *
+ * The message holds a reference to a net_buf (or a fragment chain).
+ * The message is marked with FWK_MSG_OPTION_NET_BUF so that the framework
+ * releases the reference when the message is freed.  A broadcast copy
+ * takes another reference to the same buffer.  The payload is shared, so
+ * receivers of a broadcast must treat it as read-only.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_NET_BUF_H__
+#define __FRAMEWORK_NET_BUF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr/net/buf.h>
+
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+typedef struct FwkNetBufMsg {
+	FwkMsgHeader_t header;
+	struct net_buf *pBuf; /** reference owned by the message */
+} FwkNetBufMsg_t;
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Allocates a message that refers to pBuf.  The message takes its
+ * own reference, so the caller still owns (and must unref) its reference.
+ *
+ * @note Can be called from an ISR.
+ *
+ * @param TxId source of message
+ * @param Code message type
+ * @param pBuf buffer (or first fragment of a chain)
+ *
+ * @retval pointer to message or NULL if it couldn't be allocated
+ */
+FwkNetBufMsg_t *FwkNetBufMsg_Create(FwkId_t TxId, FwkMsgCode_t Code,
+				    struct net_buf *pBuf);
+
+/**
+ * @brief Removes the buffer from the message.  The reference is given to
+ * the caller, so freeing the message no longer releases it.
+ *
+ * @retval buffer or NULL if it was already detached
+ */
+struct net_buf *FwkNetBufMsg_Detach(FwkNetBufMsg_t *pMsg);
+
+/**
+ * @brief Copies the message and takes another reference to the buffer
+ * (used by broadcast).
+ *
+ * @retval pointer to copy or NULL if it couldn't be allocated
+ */
+FwkNetBufMsg_t *FwkNetBufMsg_Clone(const FwkNetBufMsg_t *pMsg);
+
+/**
+ * @brief Releases the reference to the buffer and then frees the message.
+ */
+void FwkNetBufMsg_Free(FwkNetBufMsg_t *pMsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_NET_BUF_H__ */
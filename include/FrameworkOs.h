@@ -0,0 +1,29 @@
+/**
+ * @file FrameworkOs.h
+ * @brief Operating system services used by the framework.
+ *
+ * The framework is written against the Zephyr kernel API.  On a host
+ * (CONFIG_FWK_POSIX, set by the host CMake build) the subset of that API
+ * used by the framework is provided by FrameworkOsPosix.h so that the
+ * same sources can run in a Linux process.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_OS_H__
+#define __FRAMEWORK_OS_H__
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#ifdef CONFIG_FWK_POSIX
+#include "FrameworkOsPosix.h"
+#else
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/reboot.h>
+#endif
+
+#endif /* __FRAMEWORK_OS_H__ */
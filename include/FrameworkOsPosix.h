@@ -0,0 +1,563 @@
+/**
+ * @file FrameworkOsPosix.h
+ * @brief The subset of the Zephyr kernel API used by the framework,
+ * implemented with POSIX threads.
+ *
+ * Message queues, heaps, memory slabs, and timers have the same semantics
+ * as Zephyr.
+ * Timer expiry functions run on a timer thread that is treated as an
+ * interrupt (k_is_in_isr returns true), so a periodic message is sent the
+ * same way that it is on a target.  Thread priorities are recorded but not
+ * applied.  A tick is 1 ms.
+ *
+ * When CONFIG_FWK_POSIX_VIRTUAL_TIME is defined, time is virtual.  Threads
+ * run one at a time in priority order and the clock only advances when
+ * every thread is waiting, so a run is deterministic and takes as long as
+ * the processing (not the timeouts).  Threads must be created with
+ * k_thread_create (except the main thread).
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_OS_POSIX_H__
+#define __FRAMEWORK_OS_POSIX_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+/* Toolchain and utilities */
+#define __weak __attribute__((__weak__))
+#define __packed __attribute__((__packed__))
+#define __aligned(x) __attribute__((__aligned__(x)))
+#define __unused __attribute__((__unused__))
+
+#ifdef __cplusplus
+#define BUILD_ASSERT(e, ...) static_assert(e, "" __VA_ARGS__)
+#else
+#define BUILD_ASSERT(e, ...) _Static_assert(e, "" __VA_ARGS__)
+#endif
+
+#define ARG_UNUSED(x) (void)(x)
+#define BIT(n) (1UL << (n))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define CONTAINER_OF(ptr, type, field)                                         \
+	((type *)(((char *)(ptr)) - offsetof(type, field)))
+#define ROUND_UP(x, align)                                                     \
+	((((unsigned long)(x) + ((unsigned long)(align) - 1)) /                \
+	  (unsigned long)(align)) *                                            \
+	 (unsigned long)(align))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define IS_POWER_OF_TWO(x) (((x) != 0) && (((x) & ((x)-1)) == 0))
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef MAX
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#endif
+
+#define printk printf
+
+/* Time (a tick is 1 ms) */
+#define CONFIG_SYS_CLOCK_TICKS_PER_SEC 1000
+
+typedef struct {
+	int64_t ticks;
+} k_timeout_t;
+
+#define K_TICKS(t) ((k_timeout_t){ .ticks = (t) })
+#define K_NO_WAIT K_TICKS(0)
+#define K_FOREVER K_TICKS(-1)
+#define K_MSEC(ms) K_TICKS(ms)
+#define K_SECONDS(s) K_MSEC((s)*1000)
+#define K_MINUTES(m) K_SECONDS((m)*60)
+#define K_HOURS(h) K_MINUTES((h)*60)
+#define K_TIMEOUT_EQ(a, b) ((a).ticks == (b).ticks)
+
+/* Absolute time (ticks) of a timeout */
+typedef struct {
+	uint64_t tick;
+} k_timepoint_t;
+
+/* Atomics */
+typedef long atomic_t;
+typedef long atomic_val_t;
+typedef void *atomic_ptr_t;
+typedef void *atomic_ptr_val_t;
+
+#define ATOMIC_INIT(i) (i)
+#define ATOMIC_PTR_INIT(p) (p)
+
+/* Spinlocks are mutexes (a zeroed pthread mutex is valid on Linux) */
+struct k_spinlock {
+	pthread_mutex_t mutex;
+};
+
+typedef struct {
+	int key;
+} k_spinlock_key_t;
+
+/* Threads */
+typedef void (*k_thread_entry_t)(void *p1, void *p2, void *p3);
+typedef char k_thread_stack_t;
+
+struct k_thread {
+	pthread_t thread;
+	k_thread_entry_t entry;
+	void *p1;
+	void *p2;
+	void *p3;
+	int prio;
+	k_timeout_t delay;
+	char name[32];
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+	/* Scheduler */
+	pthread_cond_t run;
+	struct k_thread *pSimNext;
+	const void *pChannel; /** condition it is waiting on */
+	int64_t wakeAt; /** timeout */
+	uint64_t seq; /** order it became ready (or started waiting) */
+	int state;
+	bool timedOut;
+	bool simAdded;
+#endif
+};
+
+typedef struct k_thread *k_tid_t;
+
+/* The host uses its own stacks */
+#define K_THREAD_STACK_DEFINE(sym, size) k_thread_stack_t sym[1]
+#define K_THREAD_STACK_SIZEOF(sym) sizeof(sym)
+
+/* Message queues */
+struct k_msgq {
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	pthread_cond_t notFull;
+	char *buffer_start;
+	size_t msg_size;
+	uint32_t max_msgs;
+	uint32_t read_index;
+	uint32_t used_msgs;
+};
+
+struct k_msgq_attrs {
+	size_t msg_size;
+	uint32_t max_msgs;
+	uint32_t used_msgs;
+};
+
+#define K_MSGQ_DEFINE(name, size, max, align)                                  \
+	static char __aligned(align) _k_msgq_buf_##name[(size) * (max)];       \
+	struct k_msgq name = {                                                 \
+		.lock = PTHREAD_MUTEX_INITIALIZER,                             \
+		.notEmpty = PTHREAD_COND_INITIALIZER,                          \
+		.notFull = PTHREAD_COND_INITIALIZER,                           \
+		.buffer_start = _k_msgq_buf_##name,                            \
+		.msg_size = (size),                                            \
+		.max_msgs = (max),                                             \
+	}
+
+/* Heaps use malloc and are limited to their size.  Each allocation is
+ * charged a header (like a Zephyr heap chunk).
+ */
+struct k_heap {
+	struct k_spinlock lock;
+	pthread_cond_t freed;
+	size_t capacity;
+	size_t used;
+};
+
+#define K_HEAP_DEFINE(name, bytes) struct k_heap name = { .capacity = (bytes) }
+
+/* Memory slabs (blocks that have been freed are linked through their
+ * first word)
+ */
+struct k_mem_slab {
+	pthread_mutex_t lock;
+	pthread_cond_t freed;
+	char *buffer;
+	char *free_list;
+	size_t block_size;
+	uint32_t num_blocks;
+	uint32_t num_used;
+	uint32_t num_carved; /** blocks taken from buffer */
+};
+
+#define Z_FWK_OS_MEM_SLAB_DEFINE(name, size, blocks, align, storage)           \
+	static char __aligned(align)                                           \
+		_k_mem_slab_buf_##name[(size) * (blocks)];                     \
+	storage struct k_mem_slab name = {                                     \
+		.lock = PTHREAD_MUTEX_INITIALIZER,                             \
+		.freed = PTHREAD_COND_INITIALIZER,                             \
+		.buffer = _k_mem_slab_buf_##name,                              \
+		.block_size = (size),                                          \
+		.num_blocks = (blocks),                                        \
+	}
+
+#define K_MEM_SLAB_DEFINE(name, size, blocks, align)                           \
+	Z_FWK_OS_MEM_SLAB_DEFINE(name, size, blocks, align, )
+
+#define K_MEM_SLAB_DEFINE_STATIC(name, size, blocks, align)                    \
+	Z_FWK_OS_MEM_SLAB_DEFINE(name, size, blocks, align, static)
+
+/* Timers */
+struct k_timer {
+	void (*expiry_fn)(struct k_timer *timer);
+	void (*stop_fn)(struct k_timer *timer);
+	struct k_timer *next; /** active list */
+	int64_t expiry; /** ticks */
+	int64_t period; /** 0 for one shot */
+	uint32_t status;
+	void *user_data;
+	bool active;
+};
+
+/* Doubly linked lists (circular with the list as the sentinel) */
+typedef struct _dnode {
+	struct _dnode *next;
+	struct _dnode *prev;
+} sys_dnode_t;
+
+typedef sys_dnode_t sys_dlist_t;
+
+#define SYS_DLIST_STATIC_INIT(ptr_to_list)                                     \
+	{                                                                      \
+		.next = (ptr_to_list), .prev = (ptr_to_list)                   \
+	}
+
+#define SYS_DLIST_CONTAINER(node, cn, n)                                       \
+	(((node) != NULL) ? CONTAINER_OF(node, __typeof__(*(cn)), n) : NULL)
+
+#define SYS_DLIST_FOR_EACH_CONTAINER(list, cn, n)                              \
+	for (cn = SYS_DLIST_CONTAINER(sys_dlist_peek_head(list), cn, n);       \
+	     cn != NULL;                                                       \
+	     cn = SYS_DLIST_CONTAINER(sys_dlist_peek_next(list, &(cn)->n), cn, \
+				      n))
+
+/* Singly linked lists (only append and iteration) */
+typedef struct _snode {
+	struct _snode *next;
+} sys_snode_t;
+
+typedef struct {
+	sys_snode_t *head;
+	sys_snode_t *tail;
+} sys_slist_t;
+
+#define SYS_SLIST_CONTAINER(node, cn, n)                                       \
+	(((node) != NULL) ? CONTAINER_OF(node, __typeof__(*(cn)), n) : NULL)
+
+#define SYS_SLIST_FOR_EACH_CONTAINER(list, cn, n)                              \
+	for (cn = SYS_SLIST_CONTAINER((list)->head, cn, n); cn != NULL;        \
+	     cn = SYS_SLIST_CONTAINER((cn)->n.next, cn, n))
+
+/* Initialization (functions run before main in level order) */
+struct device;
+
+#define FWK_OS_INIT_PRE_KERNEL_1 1000
+#define FWK_OS_INIT_PRE_KERNEL_2 2000
+#define FWK_OS_INIT_POST_KERNEL 3000
+#define FWK_OS_INIT_APPLICATION 4000
+
+#ifndef CONFIG_KERNEL_INIT_PRIORITY_DEFAULT
+#define CONFIG_KERNEL_INIT_PRIORITY_DEFAULT 40
+#endif
+
+#define SYS_INIT(fn, level, prio)                                              \
+	static void                                                            \
+	__attribute__((constructor(FWK_OS_INIT_##level + (prio))))             \
+	_sys_init_##fn(void)                                                   \
+	{                                                                      \
+		(void)fn(NULL);                                                \
+	}
+
+/* Logging */
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERR 1
+#define LOG_LEVEL_WRN 2
+#define LOG_LEVEL_INF 3
+#define LOG_LEVEL_DBG 4
+
+#define LOG_MODULE_REGISTER(name, level)                                       \
+	static const char *const _log_name __unused = #name;                   \
+	static const int _log_level __unused = (level)
+
+#define LOG_MODULE_DECLARE(name, level) LOG_MODULE_REGISTER(name, level)
+
+#define Z_FWK_OS_LOG(level, tag, ...)                                          \
+	do {                                                                   \
+		if ((level) <= _log_level) {                                   \
+			FwkOs_Log(tag, _log_name, __VA_ARGS__);                \
+		}                                                              \
+	} while (0)
+
+#define LOG_ERR(...) Z_FWK_OS_LOG(LOG_LEVEL_ERR, "err", __VA_ARGS__)
+#define LOG_WRN(...) Z_FWK_OS_LOG(LOG_LEVEL_WRN, "wrn", __VA_ARGS__)
+#define LOG_INF(...) Z_FWK_OS_LOG(LOG_LEVEL_INF, "inf", __VA_ARGS__)
+#define LOG_DBG(...) Z_FWK_OS_LOG(LOG_LEVEL_DBG, "dbg", __VA_ARGS__)
+
+/* Reboot ends the process */
+#define SYS_REBOOT_WARM 0
+#define SYS_REBOOT_COLD 1
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+void FwkOs_Log(const char *tag, const char *module, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+/* Time */
+int64_t k_uptime_ticks(void);
+int64_t k_uptime_get(void);
+uint32_t k_uptime_get_32(void);
+int32_t k_sleep(k_timeout_t timeout);
+int32_t k_msleep(int32_t ms);
+void k_yield(void);
+
+static inline k_timepoint_t sys_timepoint_calc(k_timeout_t timeout)
+{
+	k_timepoint_t timepoint;
+
+	if (K_TIMEOUT_EQ(timeout, K_FOREVER)) {
+		timepoint.tick = UINT64_MAX;
+	} else {
+		timepoint.tick = (uint64_t)(k_uptime_ticks() +
+					    MAX(timeout.ticks, 0));
+	}
+
+	return timepoint;
+}
+
+static inline bool sys_timepoint_expired(k_timepoint_t timepoint)
+{
+	return timepoint.tick != UINT64_MAX &&
+	       timepoint.tick <= (uint64_t)k_uptime_ticks();
+}
+
+/* Atomics */
+static inline atomic_val_t atomic_get(const atomic_t *target)
+{
+	return __atomic_load_n(target, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_set(atomic_t *target, atomic_val_t value)
+{
+	return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_add(atomic_t *target, atomic_val_t value)
+{
+	return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_sub(atomic_t *target, atomic_val_t value)
+{
+	return __atomic_fetch_sub(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_inc(atomic_t *target)
+{
+	return atomic_add(target, 1);
+}
+
+static inline atomic_val_t atomic_dec(atomic_t *target)
+{
+	return atomic_sub(target, 1);
+}
+
+static inline atomic_val_t atomic_clear(atomic_t *target)
+{
+	return atomic_set(target, 0);
+}
+
+static inline atomic_val_t atomic_or(atomic_t *target, atomic_val_t value)
+{
+	return __atomic_fetch_or(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_and(atomic_t *target, atomic_val_t value)
+{
+	return __atomic_fetch_and(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline bool atomic_cas(atomic_t *target, atomic_val_t old_value,
+			      atomic_val_t new_value)
+{
+	return __atomic_compare_exchange_n(target, &old_value, new_value,
+					   false, __ATOMIC_SEQ_CST,
+					   __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_ptr_val_t atomic_ptr_get(const atomic_ptr_t *target)
+{
+	return __atomic_load_n(target, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_ptr_val_t atomic_ptr_set(atomic_ptr_t *target,
+					      atomic_ptr_val_t value)
+{
+	return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline bool atomic_ptr_cas(atomic_ptr_t *target,
+				  atomic_ptr_val_t old_value,
+				  atomic_ptr_val_t new_value)
+{
+	return __atomic_compare_exchange_n(target, &old_value, new_value,
+					   false, __ATOMIC_SEQ_CST,
+					   __ATOMIC_SEQ_CST);
+}
+
+/* Locks (a thread isn't preempted while it holds one) */
+k_spinlock_key_t k_spin_lock(struct k_spinlock *l);
+void k_spin_unlock(struct k_spinlock *l, k_spinlock_key_t key);
+
+/* One lock for the process (recursive) */
+unsigned int irq_lock(void);
+void irq_unlock(unsigned int key);
+
+bool k_is_in_isr(void);
+
+/* Threads */
+k_tid_t k_thread_create(struct k_thread *new_thread, k_thread_stack_t *stack,
+			size_t stack_size, k_thread_entry_t entry, void *p1,
+			void *p2, void *p3, int prio, uint32_t options,
+			k_timeout_t delay);
+void k_thread_start(k_tid_t thread);
+k_tid_t k_current_get(void);
+int k_thread_name_set(k_tid_t thread, const char *name);
+int k_thread_priority_get(k_tid_t thread);
+void k_thread_priority_set(k_tid_t thread, int prio);
+
+/* Message queues */
+void k_msgq_init(struct k_msgq *msgq, char *buffer, size_t msg_size,
+		 uint32_t max_msgs);
+int k_msgq_put(struct k_msgq *msgq, const void *data, k_timeout_t timeout);
+int k_msgq_get(struct k_msgq *msgq, void *data, k_timeout_t timeout);
+int k_msgq_peek(struct k_msgq *msgq, void *data);
+void k_msgq_purge(struct k_msgq *msgq);
+uint32_t k_msgq_num_free_get(struct k_msgq *msgq);
+uint32_t k_msgq_num_used_get(struct k_msgq *msgq);
+void k_msgq_get_attrs(struct k_msgq *msgq, struct k_msgq_attrs *attrs);
+
+/* Heaps */
+void *k_heap_alloc(struct k_heap *h, size_t bytes, k_timeout_t timeout);
+void *k_heap_aligned_alloc(struct k_heap *h, size_t align, size_t bytes,
+			   k_timeout_t timeout);
+void k_heap_free(struct k_heap *h, void *mem);
+
+/* Memory slabs */
+int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem,
+		     k_timeout_t timeout);
+void k_mem_slab_free(struct k_mem_slab *slab, void *mem);
+uint32_t k_mem_slab_num_used_get(struct k_mem_slab *slab);
+uint32_t k_mem_slab_num_free_get(struct k_mem_slab *slab);
+
+/* Timers */
+void k_timer_init(struct k_timer *timer,
+		  void (*expiry_fn)(struct k_timer *timer),
+		  void (*stop_fn)(struct k_timer *timer));
+void k_timer_start(struct k_timer *timer, k_timeout_t duration,
+		   k_timeout_t period);
+void k_timer_stop(struct k_timer *timer);
+uint32_t k_timer_status_get(struct k_timer *timer);
+
+static inline void k_timer_user_data_set(struct k_timer *timer,
+					 void *user_data)
+{
+	timer->user_data = user_data;
+}
+
+static inline void *k_timer_user_data_get(const struct k_timer *timer)
+{
+	return timer->user_data;
+}
+
+/* Doubly linked lists */
+static inline void sys_dlist_init(sys_dlist_t *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline sys_dnode_t *sys_dlist_peek_head(sys_dlist_t *list)
+{
+	return (list->next != list) ? list->next : NULL;
+}
+
+static inline sys_dnode_t *sys_dlist_peek_next(sys_dlist_t *list,
+					       sys_dnode_t *node)
+{
+	return (node->next != list) ? node->next : NULL;
+}
+
+static inline void sys_dlist_append(sys_dlist_t *list, sys_dnode_t *node)
+{
+	node->next = list;
+	node->prev = list->prev;
+	list->prev->next = node;
+	list->prev = node;
+}
+
+static inline void sys_dlist_remove(sys_dnode_t *node)
+{
+	node->prev->next = node->next;
+	node->next->prev = node->prev;
+	node->next = NULL;
+	node->prev = NULL;
+}
+
+/* Singly linked lists */
+static inline void sys_slist_init(sys_slist_t *list)
+{
+	list->head = NULL;
+	list->tail = NULL;
+}
+
+static inline sys_snode_t *sys_slist_peek_head(sys_slist_t *list)
+{
+	return list->head;
+}
+
+static inline sys_snode_t *sys_slist_peek_next(sys_snode_t *node)
+{
+	return node->next;
+}
+
+static inline void sys_slist_append(sys_slist_t *list, sys_snode_t *node)
+{
+	node->next = NULL;
+	if (list->tail == NULL) {
+		list->head = node;
+	} else {
+		list->tail->next = node;
+	}
+	list->tail = node;
+}
+
+/* Reboot */
+void sys_reboot(int type) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_OS_POSIX_H__ */
@@ -0,0 +1,90 @@
+/**
+ * @file FrameworkPoll.h
+ * @brief One thread servicing several receiver queues and kernel events.
+ *
+ * A poll set contains receivers and other poll events (driver semaphores,
+ * signals, FIFOs).  The thread blocks (k_poll) until any of them is ready
+ * and then dispatches the messages of each ready receiver and calls the
+ * event handler for each ready event.  A receiver's weight is the maximum
+ * number of messages dispatched each time the set is serviced, so one busy
+ * queue can't starve the others.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_POLL_H__
+#define __FRAMEWORK_POLL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+typedef struct FwkPollSource {
+	FwkMsgReceiver_t *pRxer;
+	/* Maximum messages dispatched each time (0 is the same as 1) */
+	uint8_t weight;
+} FwkPollSource_t;
+
+/**
+ * @brief Called for each event that isn't a receiver queue when it is
+ * ready.  The handler must take the resource (or reset the signal)
+ * otherwise the event will be ready again immediately.
+ */
+typedef void (*FwkPollEventHandler_t)(struct k_poll_event *pEvent,
+				      void *pContext);
+
+/**
+ * @brief Poll set
+ *
+ * pEvents must have sourceCount + eventCount entries.  The first
+ * sourceCount entries are initialized by FwkPoll_Init.  The application
+ * initializes the rest with k_poll_event_init.
+ */
+typedef struct FwkPollSet {
+	FwkPollSource_t *pSources;
+	size_t sourceCount;
+	struct k_poll_event *pEvents;
+	size_t eventCount;
+	FwkPollEventHandler_t eventHandler;
+	void *pContext;
+	/* Set by the framework */
+	size_t first;
+} FwkPollSet_t;
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Initialize the receiver queue events of a poll set.
+ *
+ * @retval 0 on success, -EINVAL if the set is invalid
+ */
+int FwkPoll_Init(FwkPollSet_t *pSet);
+
+/**
+ * @brief Wait until a receiver queue or event is ready and then service
+ * everything that is ready.  The receiver that is serviced first rotates
+ * each time.
+ *
+ * @note Priority inheritance (CONFIG_FWK_MSG_PRIORITY) isn't used for
+ * receivers in a poll set.
+ *
+ * @retval number of messages dispatched and events handled, -EAGAIN if
+ * the timeout expired
+ */
+int FwkPoll_Service(FwkPollSet_t *pSet, k_timeout_t Timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_POLL_H__ */
@@ -0,0 +1,116 @@
+/**
+ * @file FrameworkRecord.h
+ * @brief Records routed messages and replays them.
+ *
+ * When recording, every message that is queued to a receiver is captured
+ * with a timestamp, its header, and its payload.  A message that can't be
+ * queued isn't recorded.  Entries are stored in a
+ * RAM ring or passed to a sink (flash, or a host file on native_sim).
+ * A log can be replayed with the original timing or as fast as possible
+ * so that handler and router changes can be measured with real traffic.
+ *
+ * Entry: FwkRecordEntry_t followed by length bytes of payload
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_RECORD_H__
+#define __FRAMEWORK_RECORD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+typedef struct FwkRecordEntry {
+	uint32_t timeMs;
+	FwkMsgHeader_t header;
+	uint16_t size; /** size of payload when it was recorded */
+	uint16_t length; /** number of payload bytes that follow */
+} __packed FwkRecordEntry_t;
+
+/**
+ * @brief Called with each entry (instead of storing it in the RAM ring).
+ * Called from the context of the sender (which may be an interrupt).
+ */
+typedef void (*FwkRecordSink_t)(const FwkRecordEntry_t *pEntry,
+				const uint8_t *pPayload, void *pContext);
+
+typedef struct FwkRecordStats {
+	uint32_t recorded;
+	uint32_t truncated; /** payload larger than maximum */
+	uint32_t skipped; /** local only (pointers) */
+	uint32_t overflows; /** RAM ring full */
+	uint32_t notQueued; /** queue full (not recorded) */
+} FwkRecordStats_t;
+
+/* Copy of a message that is made before it is queued (the message can't
+ * be accessed after it is queued).  Placed on the stack of the sender.
+ */
+typedef struct FwkRecordCapture {
+	FwkRecordEntry_t entry;
+	uint8_t payload[CONFIG_FWK_RECORD_MAX_PAYLOAD];
+	bool active; /** false when not recording or local only */
+} FwkRecordCapture_t;
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Start recording.  The RAM ring and statistics are cleared.
+ *
+ * @param Sink NULL to record into the RAM ring
+ */
+void FwkRecord_Start(FwkRecordSink_t Sink, void *pContext);
+
+void FwkRecord_Stop(void);
+
+/**
+ * @brief Copy (and remove) entries from the RAM ring.
+ * A log that is read in pieces can be concatenated.
+ *
+ * @retval number of bytes copied
+ */
+size_t FwkRecord_Read(uint8_t *pDest, size_t Size);
+
+/**
+ * @brief Send each message in the log.  Messages are sent to the
+ * recorded receiver with Framework_Send (or with Framework_Broadcast when
+ * the receiver ID is FWK_ID_RESERVED).  Recording is paused during replay.
+ *
+ * @note Blocks until the log has been replayed (must not be called from an
+ * interrupt).
+ *
+ * @param RealTime true to wait for the recorded time between messages,
+ * false to send as fast as possible
+ *
+ * @retval number of messages sent, -EINVAL if the log is malformed
+ */
+int FwkRecord_Replay(const uint8_t *pLog, size_t Length, bool RealTime);
+
+void FwkRecord_GetStats(FwkRecordStats_t *pStats);
+
+/**
+ * @brief Called by Framework_Queue before a message is queued.
+ */
+void FwkRecord_Capture(const FwkMsg_t *pMsg, FwkRecordCapture_t *pCapture);
+
+/**
+ * @brief Called by Framework_Queue with the result of the put.  The
+ * capture is recorded only if the message was queued.
+ */
+void FwkRecord_Commit(const FwkRecordCapture_t *pCapture, int Status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_RECORD_H__ */
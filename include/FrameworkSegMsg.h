@@ -0,0 +1,115 @@
+/**
+ * @file FrameworkSegMsg.h
+ * @brief Segmented framework messages for large payloads.
+ *
+ * The payload of a segmented message is a chain of fixed-size segments
+ * taken from the buffer pool.  Large transfers (firmware chunks, log batches)
+ * don't require a large contiguous block.  The message is marked with
+ * FWK_MSG_OPTION_SEGMENTED so that the framework frees the whole chain.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_SEG_MSG_H__
+#define __FRAMEWORK_SEG_MSG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+typedef struct FwkSegment FwkSegment_t;
+
+struct FwkSegment {
+	FwkSegment_t *pNext;
+	uint16_t length; /** number of used bytes in data */
+	uint8_t data[]; /** CONFIG_FWK_SEG_MSG_SEGMENT_SIZE bytes */
+};
+
+typedef struct FwkSegMsg {
+	FwkMsgHeader_t header;
+	size_t length; /** total number of bytes in chain */
+	FwkSegment_t *pHead;
+	FwkSegment_t *pTail;
+} FwkSegMsg_t;
+
+typedef struct FwkSegIter {
+	const FwkSegment_t *pSeg;
+} FwkSegIter_t;
+
+#define FWK_SEG_MSG_SEGMENT_ALLOC_SIZE                                         \
+	(sizeof(FwkSegment_t) + CONFIG_FWK_SEG_MSG_SEGMENT_SIZE)
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Allocates an empty segmented message.
+ *
+ * @param TxId source of message
+ * @param Code message type
+ *
+ * @retval pointer to message or NULL if it couldn't be allocated
+ */
+FwkSegMsg_t *FwkSegMsg_Create(FwkId_t TxId, FwkMsgCode_t Code);
+
+/**
+ * @brief Copies data to the end of the chain.  Segments are added as needed.
+ * Either all of the data is appended or none of it is.
+ *
+ * @retval 0 on success, -ENOMEM if segments couldn't be allocated
+ */
+int FwkSegMsg_Append(FwkSegMsg_t *pMsg, const void *pData, size_t Length);
+
+/**
+ * @brief Copies up to Length bytes starting at Offset into pDest.
+ *
+ * @retval number of bytes copied
+ */
+size_t FwkSegMsg_Read(const FwkSegMsg_t *pMsg, size_t Offset, void *pDest,
+		      size_t Length);
+
+/**
+ * @brief Prepares an iterator that visits each segment of the chain.
+ */
+void FwkSegMsg_IterInit(const FwkSegMsg_t *pMsg, FwkSegIter_t *pIter);
+
+/**
+ * @brief Gets the data of the next segment.
+ *
+ * Example:
+ * FwkSegIter_t it;
+ * const uint8_t *p;
+ * size_t len;
+ * FwkSegMsg_IterInit(pMsg, &it);
+ * while ((len = FwkSegMsg_IterNext(&it, &p)) > 0) { ...
+ *
+ * @retval number of bytes in the segment, 0 when there are no more segments
+ */
+size_t FwkSegMsg_IterNext(FwkSegIter_t *pIter, const uint8_t **ppData);
+
+/**
+ * @brief Copies the message and its chain (used by broadcast).
+ *
+ * @retval pointer to copy or NULL if it couldn't be allocated
+ */
+FwkSegMsg_t *FwkSegMsg_Clone(const FwkSegMsg_t *pMsg);
+
+/**
+ * @brief Frees every segment and then the message.
+ */
+void FwkSegMsg_Free(FwkSegMsg_t *pMsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_SEG_MSG_H__ */
@@ -0,0 +1,88 @@
+/**
+ * @file FrameworkTraffic.h
+ * @brief Counts the messages and bytes routed from each sender to each
+ * receiver for each message code.
+ *
+ * The router (Framework_Send, Framework_Unicast, and Framework_Broadcast)
+ * counts each message that it queues.  A broadcast is counted once for
+ * each receiver that gets a copy.  Each (sender, receiver, code) edge has a
+ * counter for each CPU so that senders on different CPUs don't share a
+ * cache line.  When the table is full, messages on new edges are only
+ * counted as overflows.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FRAMEWORK_TRAFFIC_H__
+#define __FRAMEWORK_TRAFFIC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+typedef struct FwkTrafficEdge {
+	FwkId_t txId;
+	FwkId_t rxId;
+	FwkMsgCode_t msgCode;
+	uint32_t count; /** messages */
+	uint32_t bytes; /** buffer pool size of the messages */
+} FwkTrafficEdge_t;
+
+/**
+ * @brief Called for each edge that has carried a message since the last
+ * reset.
+ */
+typedef void (*FwkTrafficIterator_t)(const FwkTrafficEdge_t *pEdge,
+				     void *pContext);
+
+/**
+ * @brief Called with each line of an export (without a newline).
+ */
+typedef void (*FwkTrafficWriter_t)(const char *pLine, void *pContext);
+
+/******************************************************************************/
+/* Global Function Prototypes                                                 */
+/******************************************************************************/
+/**
+ * @brief Reads the matrix.  The counters of each CPU are added.
+ *
+ * @retval number of edges
+ */
+size_t FwkTraffic_ForEach(FwkTrafficIterator_t Iterator, void *pContext);
+
+/**
+ * @brief Clears the counters.  The edges stay in the table.
+ */
+void FwkTraffic_Reset(void);
+
+/**
+ * @retval number of messages that weren't counted because the table was full
+ */
+uint32_t FwkTraffic_Overflows(void);
+
+/**
+ * @brief Writes the message graph in Graphviz DOT format.  The width of
+ * each edge is proportional to its message count.
+ */
+void FwkTraffic_WriteDot(FwkTrafficWriter_t Writer, void *pContext);
+
+/**
+ * @brief Called by the router after a message is queued.
+ */
+void FwkTraffic_Count(FwkId_t TxId, FwkId_t RxId, FwkMsgCode_t Code,
+		      size_t Size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FRAMEWORK_TRAFFIC_H__ */
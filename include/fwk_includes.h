@@ -25,6 +25,9 @@ extern "C" {
 #include <framework_ids.h>
 #include <framework_msgcodes.h>
 #include <framework_types.h>
+#ifdef CONFIG_FWK_TYPE_POOLS
+#include <framework_pools.h>
+#endif
 
 #ifdef __cplusplus
 }
@@ -8,7 +8,7 @@
  */
 
 #define FWK_FNAME "BufferPool"
-#include <logging/log.h>
+#include "FrameworkOs.h"
 LOG_MODULE_REGISTER(buffer_pool, LOG_LEVEL_WRN);
 
 /******************************************************************************/
@@ -19,19 +19,85 @@ LOG_MODULE_REGISTER(buffer_pool, LOG_LEVEL_WRN);
 #include "Framework.h"
 #include "BufferPool.h"
 
+#ifdef CONFIG_BUFFER_POOL_HEAP_STATS
+/* Private sys_heap header (lib/heap) is required to read the free lists */
+#include <heap.h>
+#endif
+
+#if defined(CONFIG_BUFFER_POOL_QUOTAS) &&                                      \
+	defined(CONFIG_FWK_AUTO_GENERATE_FILES)
+#include <framework_ids.h>
+#endif
+
+#if defined(CONFIG_FWK_TYPE_POOLS) && !defined(CONFIG_FWK_POSIX)
+#if __has_include(<zephyr/version.h>)
+#include <zephyr/version.h>
+#else
+#include <version.h>
+#endif
+#endif
+
 /******************************************************************************/
 /* Local Constant, Macro and Type Definitions                                 */
 /******************************************************************************/
-struct bph {
-#ifdef CONFIG_BUFFER_POOL_CHECK_DOUBLE_FREE
-	void *ptr;
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+#define OTHER_SITE (CONFIG_BUFFER_POOL_MAX_SITES - 1)
+#define TRACK_ALIGN __alignof__(struct bp_track)
+#else
+#define TRACK_ALIGN 1
 #endif
-	uint16_t size;
-	uint8_t pool;
-	uint8_t reserved;
-} __packed;
 
-#define BPH_SIZE sizeof(struct bph)
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+#define TAKE_CLASS_NORMAL BP_CLASS_NORMAL
+#define TAKE_CLASS_CRITICAL BP_CLASS_CRITICAL
+
+/* Remaining space (bytes) at or below which each level starts */
+#define LOW_WATERMARK                                                          \
+	((CONFIG_BUFFER_POOL_SIZE * CONFIG_BUFFER_POOL_PRESSURE_LOW_PERCENT) / \
+	 100)
+#define HIGH_WATERMARK                                                         \
+	((CONFIG_BUFFER_POOL_SIZE *                                            \
+	  CONFIG_BUFFER_POOL_PRESSURE_HIGH_PERCENT) /                          \
+	 100)
+
+BUILD_ASSERT(CONFIG_BUFFER_POOL_PRESSURE_HIGH_PERCENT <
+		     CONFIG_BUFFER_POOL_PRESSURE_LOW_PERCENT,
+	     "High pressure watermark must be below low watermark");
+#else
+#define TAKE_CLASS_NORMAL 0
+#define TAKE_CLASS_CRITICAL 0
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+/* When generating IDs the total number is known. */
+#ifdef CONFIG_FWK_AUTO_GENERATE_FILES
+#define QUOTA_IDS __FRAMEWORK_MAX_MSG_RECEIVERS
+#else
+#define QUOTA_IDS CONFIG_FWK_MAX_MSG_RECEIVERS
+#endif
+#define TAKE_OWNER_NONE BP_OWNER_NONE
+#else
+#define TAKE_OWNER_NONE 0
+#endif
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+/* Before Zephyr 3.5 the address of the block pointer was passed */
+#if defined(CONFIG_FWK_POSIX) || (KERNEL_VERSION_NUMBER >= 0x030500)
+#define SLAB_FREE(slab, block) k_mem_slab_free(slab, block)
+#else
+#define SLAB_FREE(slab, block) k_mem_slab_free(slab, (void **)&(block))
+#endif
+#endif
+
+/* Type pool IDs must be less than BP_ALIGNED_POOL */
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+#define IS_HEAP_BLOCK(bph)                                                     \
+	((bph)->pool == BP_HEAP_POOL || (bph)->pool == BP_ALIGNED_POOL)
+#define BLOCK_PAD(block) BlockPad(block)
+#else
+#define IS_HEAP_BLOCK(bph) ((bph)->pool == BP_HEAP_POOL)
+#define BLOCK_PAD(block) 0
+#endif
 
 /******************************************************************************/
 /* Local Data Definitions                                                     */
@@ -44,13 +110,92 @@ static atomic_t take_failed = ATOMIC_INIT(0);
 static struct bp_stats bps;
 #endif
 
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+static struct bp_site_stats sites[CONFIG_BUFFER_POOL_MAX_SITES];
+static sys_dlist_t live_list = SYS_DLIST_STATIC_INIT(&live_list);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+static struct bp_quota_stats quotas[QUOTA_IDS];
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+/* Bytes taken (or reserved by a take) from the heap including overhead */
+static atomic_t heap_used;
+static atomic_t pressure;
+static atomic_t pressure_notifying;
+static sys_slist_t pressure_callbacks;
+static struct k_spinlock pressure_lock;
+#endif
+
+#if CONFIG_BUFFER_POOL_QUARANTINE_SIZE > 0
+/* Sampled freed blocks are held here until they are checked */
+static uint8_t *quarantine[CONFIG_BUFFER_POOL_QUARANTINE_SIZE];
+static size_t quarantine_head;
+static size_t quarantine_count;
+static atomic_t free_count;
+#endif
+
 /******************************************************************************/
 /* Local Function Prototypes                                                  */
 /******************************************************************************/
 #ifdef CONFIG_BUFFER_POOL_STATS
-static void TakeStatHandler(struct bph *bph, size_t size);
+static void TakeStatHandler(uint8_t *block, size_t size,
+			    const char *const context);
 static void TakeFailStatHandler(size_t size);
-static void GiveStatHandler(struct bph *bph);
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+static void RejectStatHandler(void);
+#endif
+static void GiveStatHandler(uint8_t *block);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+static void TakeSiteHandler(uint8_t *block, size_t size,
+			    const char *context);
+static void GiveSiteHandler(uint8_t *block, size_t size);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_HEAP_STATS
+static void HeapStatHandler(struct bp_stats *stats);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+static void IntegrityTake(uint8_t *block, size_t size);
+static bool IntegrityGive(uint8_t *block);
+static const char *PoolName(const uint8_t *buffer);
+static const char *BlockContext(uint8_t *block);
+#endif
+
+#if CONFIG_BUFFER_POOL_QUARANTINE_SIZE > 0
+static bool QuarantinePut(uint8_t *block);
+static bool QuarantineRelease(void);
+static void CheckPoison(uint8_t *block);
+#endif
+
+static void ReleaseBlock(uint8_t *block);
+static void *HeapAlloc(size_t align, size_t size, k_timeout_t timeout);
+static void *TakeFromHeap(size_t size, size_t align, size_t offset, int cls,
+			  uint16_t owner, k_timeout_t timeout,
+			  const char *const context);
+
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+static size_t BlockPad(const uint8_t *block);
+#endif
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+static int SlabAlloc(struct k_mem_slab *slab, uint8_t **block,
+		     k_timeout_t timeout);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+static bool QuotaCharge(uint16_t owner, size_t size);
+static void QuotaRelease(uint16_t owner, size_t size);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+static enum bp_pressure PressureLevel(atomic_val_t used);
+static void UpdatePressure(void);
+static sys_snode_t *NextPressureCallback(sys_snode_t *node);
 #endif
 
 /******************************************************************************/
@@ -71,24 +216,134 @@ void BufferPool_Initialize(void)
 void *BufferPool_TryToTakeTimeout(size_t size, k_timeout_t timeout,
 				  const char *const context)
 {
-	size_t size_with_header = size + BPH_SIZE;
-	uint8_t *p = k_heap_alloc(&buffer_pool, size_with_header, timeout);
+	return TakeFromHeap(size, 0, 0, TAKE_CLASS_NORMAL, TAKE_OWNER_NONE,
+			    timeout, context);
+}
 
-	if (p != NULL) {
-		memset(p, 0, size_with_header);
-#ifdef CONFIG_BUFFER_POOL_STATS
-		TakeStatHandler((struct bph *)p, size);
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+void *BufferPool_TryToTakeAligned(size_t size, size_t align, size_t offset,
+				  const char *const context)
+{
+	if (align == 0 || align > BP_ALIGN_MAX || (align & (align - 1)) != 0) {
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+	return TakeFromHeap(size, align, offset, TAKE_CLASS_NORMAL,
+			    TAKE_OWNER_NONE, K_NO_WAIT, context);
+}
 #endif
-		return p + BPH_SIZE;
-	} else {
-		/* A timeout can occur even when there is space available. */
-		LOG_WRN("Allocate failure size: %d context: %s", size, context);
-#ifdef CONFIG_BUFFER_POOL_STATS
-		TakeFailStatHandler(size);
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+void *BufferPool_TryToTakeId(size_t size, uint16_t id,
+			     const char *const context)
+{
+	return TakeFromHeap(size, 0, 0, TAKE_CLASS_NORMAL, id, K_NO_WAIT,
+			    context);
+}
+
+int BufferPool_SetQuota(uint16_t id, uint32_t quota)
+{
+	if (id >= QUOTA_IDS) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	quotas[id].quota = quota;
+	k_spin_unlock(&buffer_pool.lock, key);
+
+	return 0;
+}
+
+int BufferPool_GetQuotaStats(uint16_t id, struct bp_quota_stats *stats)
+{
+	if (id >= QUOTA_IDS || stats == NULL) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	*stats = quotas[id];
+	k_spin_unlock(&buffer_pool.lock, key);
+
+	return 0;
+}
+
+uint16_t BufferPool_GetQuotaIds(void)
+{
+	return QUOTA_IDS;
+}
 #endif
-		return p;
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+void *BufferPool_TryToTakeClass(size_t size, enum bp_class cls,
+				k_timeout_t timeout, const char *const context)
+{
+	return TakeFromHeap(size, 0, 0, cls, TAKE_OWNER_NONE, timeout,
+			    context);
+}
+
+enum bp_pressure BufferPool_GetPressure(void)
+{
+	return (enum bp_pressure)atomic_get(&pressure);
+}
+
+void BufferPool_AddPressureCallback(struct bp_pressure_callback *callback)
+{
+	if (callback == NULL || callback->handler == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&pressure_lock);
+	sys_slist_append(&pressure_callbacks, &callback->node);
+	k_spin_unlock(&pressure_lock, key);
+}
+#endif
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+void *BufferPool_TryToTakeFromPool(uint8_t pool, size_t size,
+				   k_timeout_t timeout,
+				   const char *const context)
+{
+	const struct bp_type_pool *type_pool;
+	uint8_t *p = NULL;
+
+	if (pool == BP_HEAP_POOL) {
+		return BufferPool_TryToTakeTimeout(size, timeout, context);
+	}
+	if (pool > fwk_type_pool_count) {
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+	type_pool = &fwk_type_pools[pool - 1];
+	if (size > type_pool->size || size > BP_SIZE_MAX) {
+		LOG_ERR("Size %zu too large for pool %s", size, type_pool->name);
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
 	}
+
+	if (SlabAlloc(type_pool->slab, &p, timeout) != 0) {
+		LOG_WRN("Pool %s empty context: %s", type_pool->name, context);
+		return NULL;
+	}
+
+	memset(p, 0, size + BP_BLOCK_OVERHEAD);
+	((struct bph *)(p + BP_TRACK_SIZE))->size = size;
+	((struct bph *)(p + BP_TRACK_SIZE))->pool = pool;
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+	/* Type pools aren't charged (0 is a valid ID) */
+	((struct bph *)(p + BP_TRACK_SIZE))->owner = BP_OWNER_NONE;
+#endif
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+	IntegrityTake(p, size);
+#endif
+#ifdef CONFIG_BUFFER_POOL_STATS
+	TakeStatHandler(p, size, context);
+#endif
+	return p + BP_BLOCK_OVERHEAD;
 }
+#endif
 
 void *BufferPool_TryToTake(size_t size, const char *const context)
 {
@@ -97,7 +352,8 @@ void *BufferPool_TryToTake(size_t size, const char *const context)
 
 void *BufferPool_Take(size_t size)
 {
-	void *ptr = BufferPool_TryToTake(size, BP_CONTEXT_UNUSED);
+	void *ptr = TakeFromHeap(size, 0, 0, TAKE_CLASS_CRITICAL,
+				 TAKE_OWNER_NONE, K_NO_WAIT, BP_CONTEXT_UNUSED);
 
 	if (ptr == NULL) {
 		/* Prevent recursive entry. */
@@ -119,13 +375,43 @@ void BufferPool_Free(void *pBuffer)
 		return;
 	}
 
-	p -= BPH_SIZE;
+	p -= BP_BLOCK_OVERHEAD;
+
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+	/* The size and pool can't be trusted when the header is bad */
+	if (!IntegrityGive(p)) {
+		return;
+	}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+	struct bph *bph = (struct bph *)(p + BP_TRACK_SIZE);
+	QuotaRelease(bph->owner, bph->size + BP_BLOCK_OVERHEAD +
+					 BP_TRAILER_SIZE + BLOCK_PAD(p));
+#endif
 
 #ifdef CONFIG_BUFFER_POOL_STATS
-	GiveStatHandler((struct bph *)p);
+	GiveStatHandler(p);
+#endif
+
+#if CONFIG_BUFFER_POOL_QUARANTINE_SIZE > 0
+	if (QuarantinePut(p)) {
+		return;
+	}
 #endif
 
-	k_heap_free(&buffer_pool, p);
+	ReleaseBlock(p);
+}
+
+size_t BufferPool_GetSize(const void *pBuffer)
+{
+	const uint8_t *p = pBuffer;
+
+	if (p == NULL) {
+		return 0;
+	}
+
+	return ((const struct bph *)(p - BP_HEADER_SIZE))->size;
 }
 
 int BufferPool_GetStats(uint8_t index, struct bp_stats *stats)
@@ -134,45 +420,617 @@ int BufferPool_GetStats(uint8_t index, struct bp_stats *stats)
 	if (index == 0 && stats != NULL) {
 		k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
 		memcpy(stats, &bps, sizeof(struct bp_stats));
+#ifdef CONFIG_BUFFER_POOL_HEAP_STATS
+		HeapStatHandler(stats);
+#endif
 		k_spin_unlock(&buffer_pool.lock, key);
 		return 0;
 	}
+#else
+	ARG_UNUSED(index);
+	ARG_UNUSED(stats);
 #endif
 
 	return -EINVAL;
 }
 
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+int BufferPool_GetSiteStats(uint8_t index, struct bp_site_stats *stats)
+{
+	int r = -ENOENT;
+
+	if (stats == NULL) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	if (index < CONFIG_BUFFER_POOL_MAX_SITES &&
+	    sites[index].context != NULL) {
+		memcpy(stats, &sites[index], sizeof(struct bp_site_stats));
+		r = 0;
+	}
+	k_spin_unlock(&buffer_pool.lock, key);
+
+	return r;
+}
+
+size_t BufferPool_GetAgedBuffers(uint32_t min_age_ms,
+				 struct bp_aged_buffer *list, size_t max)
+{
+	struct bp_track *track;
+	uint8_t *block;
+	struct bph *bph;
+	uint32_t now = k_uptime_get_32();
+	size_t count = 0;
+
+	if (list == NULL) {
+		return 0;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	/* Oldest allocations are at the head of the list */
+	SYS_DLIST_FOR_EACH_CONTAINER (&live_list, track, node) {
+		if (count >= max || (now - track->take_ms) < min_age_ms) {
+			break;
+		}
+		block = (uint8_t *)track + track->pad;
+		bph = (struct bph *)(block + BP_TRACK_SIZE);
+		list[count].context = sites[track->site].context;
+		list[count].buffer = block + BP_BLOCK_OVERHEAD;
+		list[count].size = bph->size;
+		list[count].age_ms = now - track->take_ms;
+		count += 1;
+	}
+	k_spin_unlock(&buffer_pool.lock, key);
+
+	return count;
+}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+__weak void BufferPool_IntegrityHandler(enum bp_integrity_error error,
+					void *buffer, const char *context)
+{
+	static const char *const errors[] = { "Bad header", "Double free",
+					      "Overflow", "Use after free" };
+
+	LOG_ERR("%s buffer: %p context: %s", errors[error], buffer,
+		(context != NULL) ? context : "unknown");
+}
+#endif
+
 /******************************************************************************/
 /* Local Function Definitions                                                 */
 /******************************************************************************/
+/**
+ * @brief Quarantined blocks are released (oldest first) only when the
+ * heap doesn't have space for a take.
+ *
+ * @param align 0 for the natural alignment of the heap
+ */
+static void *HeapAlloc(size_t align, size_t size, k_timeout_t timeout)
+{
+	void *p;
+
+#if CONFIG_BUFFER_POOL_QUARANTINE_SIZE > 0
+	do {
+		p = (align > 0) ? k_heap_aligned_alloc(&buffer_pool, align,
+						       size, K_NO_WAIT) :
+				  k_heap_alloc(&buffer_pool, size, K_NO_WAIT);
+	} while (p == NULL && QuarantineRelease());
+
+	if (p != NULL || K_TIMEOUT_EQ(timeout, K_NO_WAIT)) {
+		return p;
+	}
+#endif
+
+	if (align > 0) {
+		p = k_heap_aligned_alloc(&buffer_pool, align, size, timeout);
+	} else {
+		p = k_heap_alloc(&buffer_pool, size, timeout);
+	}
+
+	return p;
+}
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+/* The quarantine may hold blocks of the pool */
+static int SlabAlloc(struct k_mem_slab *slab, uint8_t **block,
+		     k_timeout_t timeout)
+{
+#if CONFIG_BUFFER_POOL_QUARANTINE_SIZE > 0
+	int r;
+
+	do {
+		r = k_mem_slab_alloc(slab, (void **)block, K_NO_WAIT);
+	} while (r != 0 && QuarantineRelease());
+
+	if (r == 0 || K_TIMEOUT_EQ(timeout, K_NO_WAIT)) {
+		return r;
+	}
+#endif
+
+	return k_mem_slab_alloc(slab, (void **)block, timeout);
+}
+#endif
+
+/**
+ * @param align 0 for the natural alignment of the heap
+ * @param offset the returned pointer plus offset is a multiple of align
+ */
+static void *TakeFromHeap(size_t size, size_t align, size_t offset, int cls,
+			  uint16_t owner, k_timeout_t timeout,
+			  const char *const context)
+{
+	size_t size_with_header = size + BP_BLOCK_OVERHEAD + BP_TRAILER_SIZE;
+	size_t pad = 0;
+	uint8_t *p;
+
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+	/* At least one byte of padding is required to store its length */
+	if (align > 0) {
+		pad = ROUND_UP(BP_BLOCK_OVERHEAD + offset + 1, align) -
+		      (BP_BLOCK_OVERHEAD + offset);
+		size_with_header += pad;
+	}
+#else
+	ARG_UNUSED(align);
+	ARG_UNUSED(offset);
+#endif
+
+	/* The size is stored in the header and used to release the block */
+	if (size > BP_SIZE_MAX || size_with_header > BP_SIZE_MAX) {
+		LOG_ERR("Size %zu too large context: %s", size, context);
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+	/* Reject early (without waiting) to leave room for higher classes.
+	 * The space is reserved by the check so that concurrent takes can't
+	 * all be admitted on the same remaining space.
+	 */
+	if (cls < (int)PressureLevel(atomic_add(&heap_used, size_with_header) +
+				     size_with_header)) {
+		atomic_sub(&heap_used, size_with_header);
+#ifdef CONFIG_BUFFER_POOL_STATS
+		RejectStatHandler();
+#endif
+		return NULL;
+	}
+#else
+	ARG_UNUSED(cls);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+	if (!QuotaCharge(owner, size_with_header)) {
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+		atomic_sub(&heap_used, size_with_header);
+#endif
+		return NULL;
+	}
+#else
+	ARG_UNUSED(owner);
+#endif
+
+	/* The padding follows the track so the track is aligned */
+	p = HeapAlloc((pad > 0) ? MAX(align, TRACK_ALIGN) : 0,
+		      size_with_header, timeout);
+	if (p != NULL) {
+		memset(p, 0, size_with_header);
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+		if (pad > 0) {
+			p += pad;
+			(p + BP_TRACK_SIZE)[-1] = (uint8_t)pad;
+			((struct bph *)(p + BP_TRACK_SIZE))->pool =
+				BP_ALIGNED_POOL;
+		}
+#endif
+		((struct bph *)(p + BP_TRACK_SIZE))->size = size;
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+		((struct bph *)(p + BP_TRACK_SIZE))->owner = owner;
+#endif
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+		UpdatePressure();
+#endif
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+		IntegrityTake(p, size);
+#endif
+#ifdef CONFIG_BUFFER_POOL_STATS
+		TakeStatHandler(p, size, context);
+#endif
+		return p + BP_BLOCK_OVERHEAD;
+	} else {
+		/* A timeout can occur even when there is space available. */
+		LOG_WRN("Allocate failure size: %zu context: %s", size, context);
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+		QuotaRelease(owner, size_with_header);
+#endif
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+		atomic_sub(&heap_used, size_with_header);
+		UpdatePressure();
+#endif
+#ifdef CONFIG_BUFFER_POOL_STATS
+		TakeFailStatHandler(size);
+#endif
+		return p;
+	}
+}
+
+static void ReleaseBlock(uint8_t *block)
+{
+	size_t pad = BLOCK_PAD(block);
+#if defined(CONFIG_FWK_TYPE_POOLS) || defined(CONFIG_BUFFER_POOL_ADMISSION)
+	struct bph *bph = (struct bph *)(block + BP_TRACK_SIZE);
+#endif
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+	if (!IS_HEAP_BLOCK(bph)) {
+		SLAB_FREE(fwk_type_pools[bph->pool - 1].slab, block);
+		return;
+	}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+	/* Read before the header is freed */
+	size_t size_with_header =
+		bph->size + BP_BLOCK_OVERHEAD + BP_TRAILER_SIZE + pad;
+#endif
+
+	k_heap_free(&buffer_pool, block - pad);
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+	/* Released after the free so that a take admitted on the space can
+	 * allocate it
+	 */
+	atomic_sub(&heap_used, size_with_header);
+	UpdatePressure();
+#endif
+}
+
+#ifdef CONFIG_BUFFER_POOL_ALIGNED
+static size_t BlockPad(const uint8_t *block)
+{
+	const struct bph *bph = (const struct bph *)(block + BP_TRACK_SIZE);
+
+	return (bph->pool == BP_ALIGNED_POOL) ? (block + BP_TRACK_SIZE)[-1] : 0;
+}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+/**
+ * @retval false if the take would exceed the quota of the owner
+ */
+static bool QuotaCharge(uint16_t owner, size_t size)
+{
+	struct bp_quota_stats *q;
+	bool ok = true;
+
+	if (owner >= QUOTA_IDS) {
+		return true;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	q = &quotas[owner];
+	if (q->quota != 0 && (q->used + size) > q->quota) {
+		q->failures += 1;
+		ok = false;
+	} else {
+		q->used += size;
+		q->peak = MAX(q->peak, q->used);
+	}
+	k_spin_unlock(&buffer_pool.lock, key);
+
+	return ok;
+}
+
+static void QuotaRelease(uint16_t owner, size_t size)
+{
+	if (owner >= QUOTA_IDS) {
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	quotas[owner].used -= size;
+	k_spin_unlock(&buffer_pool.lock, key);
+}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+static enum bp_pressure PressureLevel(atomic_val_t used)
+{
+	atomic_val_t remaining = CONFIG_BUFFER_POOL_SIZE - used;
+
+	if (remaining <= HIGH_WATERMARK) {
+		return BP_PRESSURE_HIGH;
+	} else if (remaining <= LOW_WATERMARK) {
+		return BP_PRESSURE_LOW;
+	} else {
+		return BP_PRESSURE_NONE;
+	}
+}
+
+/**
+ * @brief Report a change of level.  One context reports at a time without
+ * a lock held, so a callback can take or free buffers.  A change made
+ * while callbacks are called (by the callbacks or another context) is
+ * reported by the context that is reporting once they return.
+ */
+static void UpdatePressure(void)
+{
+	struct bp_pressure_callback *callback;
+	enum bp_pressure level;
+	sys_snode_t *node;
+
+	while (true) {
+		level = PressureLevel(atomic_get(&heap_used));
+		if (level == (enum bp_pressure)atomic_get(&pressure)) {
+			return;
+		}
+		/* The reporting context reads the level again when done */
+		if (!atomic_cas(&pressure_notifying, 0, 1)) {
+			return;
+		}
+
+		level = PressureLevel(atomic_get(&heap_used));
+		if (atomic_set(&pressure, level) != level) {
+			for (node = NextPressureCallback(NULL); node != NULL;
+			     node = NextPressureCallback(node)) {
+				callback = SYS_SLIST_CONTAINER(node, callback,
+							       node);
+				callback->handler(level, callback->user_data);
+			}
+		}
+
+		atomic_clear(&pressure_notifying);
+	}
+}
+
+/* Callbacks are never removed, so a node is valid without the lock */
+static sys_snode_t *NextPressureCallback(sys_snode_t *node)
+{
+	k_spinlock_key_t key = k_spin_lock(&pressure_lock);
+	node = (node == NULL) ? sys_slist_peek_head(&pressure_callbacks) :
+				sys_slist_peek_next(node);
+	k_spin_unlock(&pressure_lock, key);
+
+	return node;
+}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_INTEGRITY
+static void IntegrityTake(uint8_t *block, size_t size)
+{
+	struct bph *bph = (struct bph *)(block + BP_TRACK_SIZE);
+	uint16_t guard = BP_GUARD;
+
+	bph->reserved = BP_MARKER_TAKEN;
+	memcpy(block + BP_BLOCK_OVERHEAD + size, &guard, sizeof(guard));
+}
+
+/**
+ * @brief Check the canary and guard and then poison the buffer.
+ *
+ * @retval false if the block must not be returned to the pool
+ */
+static bool IntegrityGive(uint8_t *block)
+{
+	struct bph *bph = (struct bph *)(block + BP_TRACK_SIZE);
+	uint8_t *buffer = block + BP_BLOCK_OVERHEAD;
+	uint16_t guard;
+
+	/* A block that was returned to its pool may have been reused (or
+	 * its canary overwritten by the free list of the allocator), so only
+	 * the address can be used.
+	 */
+	if (bph->reserved != BP_MARKER_TAKEN) {
+		BufferPool_IntegrityHandler((bph->reserved == 0) ?
+						    BP_INTEGRITY_DOUBLE_FREE :
+						    BP_INTEGRITY_BAD_HEADER,
+					    buffer, PoolName(buffer));
+		return false;
+	}
+
+	memcpy(&guard, buffer + bph->size, sizeof(guard));
+	if (guard != BP_GUARD) {
+		BufferPool_IntegrityHandler(BP_INTEGRITY_OVERFLOW, buffer,
+					    BlockContext(block));
+	}
+
+	bph->reserved = 0;
+	memset(buffer, BP_POISON, bph->size);
+
+	return true;
+}
+
+/* Find the pool from the address (the header may not be valid) */
+static const char *PoolName(const uint8_t *buffer)
+{
+#ifdef CONFIG_FWK_TYPE_POOLS
+	const struct bp_type_pool *type_pool;
+	const uint8_t *start;
+	size_t block_size;
+	uint8_t i;
+
+	for (i = 0; i < fwk_type_pool_count; i++) {
+		type_pool = &fwk_type_pools[i];
+		start = (const uint8_t *)type_pool->slab->buffer;
+		/* Same as BP_TYPE_POOL_BLOCK_SIZE */
+		block_size = ROUND_UP(type_pool->size + BP_BLOCK_OVERHEAD +
+					      BP_TRAILER_SIZE,
+				      sizeof(void *));
+		if (buffer >= start &&
+		    buffer < start + (block_size * type_pool->count)) {
+			return type_pool->name;
+		}
+	}
+#else
+	ARG_UNUSED(buffer);
+#endif
+
+	return "heap";
+}
+
+/**
+ * @brief The context of a take isn't stored in the header (it would cost a
+ * pointer per buffer).  The site statistics record the take context.
+ * Otherwise the pool is used.  The header must be valid.
+ */
+static const char *BlockContext(uint8_t *block)
+{
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+	const struct bp_track *track =
+		(const struct bp_track *)(block - BLOCK_PAD(block));
+
+	if (track->site < CONFIG_BUFFER_POOL_MAX_SITES &&
+	    sites[track->site].context != NULL) {
+		return sites[track->site].context;
+	}
+#endif
+
+	return PoolName(block + BP_BLOCK_OVERHEAD);
+}
+#endif
+
+#if CONFIG_BUFFER_POOL_QUARANTINE_SIZE > 0
+/**
+ * @brief Hold every Nth freed block so that writes after it was freed
+ * can be detected.  The oldest block is released when the quarantine is
+ * full.
+ *
+ * @retval true if the block was put in quarantine
+ */
+static bool QuarantinePut(uint8_t *block)
+{
+	uint8_t *oldest = NULL;
+	size_t tail;
+
+	if ((atomic_inc(&free_count) % CONFIG_BUFFER_POOL_INTEGRITY_SAMPLE) !=
+	    0) {
+		return false;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	if (quarantine_count == CONFIG_BUFFER_POOL_QUARANTINE_SIZE) {
+		oldest = quarantine[quarantine_head];
+		quarantine_head = (quarantine_head + 1) %
+				  CONFIG_BUFFER_POOL_QUARANTINE_SIZE;
+		quarantine_count -= 1;
+	}
+	tail = (quarantine_head + quarantine_count) %
+	       CONFIG_BUFFER_POOL_QUARANTINE_SIZE;
+	quarantine[tail] = block;
+	quarantine_count += 1;
+	k_spin_unlock(&buffer_pool.lock, key);
+
+	if (oldest != NULL) {
+		CheckPoison(oldest);
+		ReleaseBlock(oldest);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Check and release the oldest block.  Called when a take fails
+ * so that blocks stay in quarantine for as long as the space isn't needed.
+ *
+ * @retval false if the quarantine was empty
+ */
+static bool QuarantineRelease(void)
+{
+	uint8_t *oldest = NULL;
+
+	/* Avoid the lock when the quarantine is empty */
+	if (quarantine_count == 0) {
+		return false;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	if (quarantine_count > 0) {
+		oldest = quarantine[quarantine_head];
+		quarantine_head = (quarantine_head + 1) %
+				  CONFIG_BUFFER_POOL_QUARANTINE_SIZE;
+		quarantine_count -= 1;
+	}
+	k_spin_unlock(&buffer_pool.lock, key);
+
+	if (oldest == NULL) {
+		return false;
+	}
+
+	CheckPoison(oldest);
+	ReleaseBlock(oldest);
+	return true;
+}
+
+static void CheckPoison(uint8_t *block)
+{
+	struct bph *bph = (struct bph *)(block + BP_TRACK_SIZE);
+	uint8_t *buffer = block + BP_BLOCK_OVERHEAD;
+	size_t i;
+
+	for (i = 0; i < bph->size; i++) {
+		if (buffer[i] != BP_POISON) {
+			BufferPool_IntegrityHandler(
+				BP_INTEGRITY_USE_AFTER_FREE, buffer,
+				BlockContext(block));
+			break;
+		}
+	}
+}
+#endif
 #ifdef CONFIG_BUFFER_POOL_STATS
-static void TakeStatHandler(struct bph *bph, size_t size)
+static void TakeStatHandler(uint8_t *block, size_t size,
+			    const char *const context)
 {
+	struct bph *bph = (struct bph *)(block + BP_TRACK_SIZE);
+
+	ARG_UNUSED(context);
+
 	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
 
-	bph->size = size;
 #ifdef CONFIG_BUFFER_POOL_CHECK_DOUBLE_FREE
+#ifdef CONFIG_FWK_COMPACT_MSG
+	bph->reserved = BP_MARKER_TAKEN;
+#else
 	bph->ptr = bph;
+#endif
 #endif
 
-	bps.space_available -= size;
-	bps.min_space_available =
-		MIN(bps.min_space_available, bps.space_available);
-	bps.min_size = MIN(bps.min_size, size);
-	bps.max_size = MAX(bps.max_size, size);
-	bps.allocs += 1;
-	bps.cur_allocs += 1;
-	bps.max_allocs = MAX(bps.max_allocs, bps.cur_allocs);
+	/* Type pools are fixed size and don't affect the heap statistics */
+	if (IS_HEAP_BLOCK(bph)) {
+		bps.space_available -= size;
+		bps.min_space_available =
+			MIN(bps.min_space_available, bps.space_available);
+		bps.min_size = MIN(bps.min_size, (int)size);
+		bps.max_size = MAX(bps.max_size, (int)size);
+		bps.allocs += 1;
+		bps.cur_allocs += 1;
+		bps.max_allocs = MAX(bps.max_allocs, bps.cur_allocs);
 #if CONFIG_BUFFER_POOL_WINDOW_SIZE > 0
-	bps.window[bps.windex++] = size;
-	if (bps.windex >= CONFIG_BUFFER_POOL_WINDOW_SIZE) {
-		bps.windex = 0;
+		bps.window[bps.windex++] = size;
+		if (bps.windex >= CONFIG_BUFFER_POOL_WINDOW_SIZE) {
+			bps.windex = 0;
+		}
+#endif
 	}
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+	TakeSiteHandler(block, size, context);
 #endif
 
 	k_spin_unlock(&buffer_pool.lock, key);
 }
 
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+static void RejectStatHandler(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
+	bps.rejections += 1;
+	k_spin_unlock(&buffer_pool.lock, key);
+}
+#endif
+
 static void TakeFailStatHandler(size_t size)
 {
 	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
@@ -180,16 +1038,26 @@ static void TakeFailStatHandler(size_t size)
 	bps.take_failures += 1;
 	bps.last_fail_size = size;
 	bps.min_space_available =
-		MIN(bps.min_space_available, (bps.space_available - size));
+		MIN(bps.min_space_available, (bps.space_available - (int)size));
 
 	k_spin_unlock(&buffer_pool.lock, key);
 }
 
-static void GiveStatHandler(struct bph *bph)
+static void GiveStatHandler(uint8_t *block)
 {
+	struct bph *bph = (struct bph *)(block + BP_TRACK_SIZE);
 	k_spinlock_key_t key = k_spin_lock(&buffer_pool.lock);
 
 #ifdef CONFIG_BUFFER_POOL_CHECK_DOUBLE_FREE
+#ifdef CONFIG_FWK_COMPACT_MSG
+	if (bph->reserved == 0) {
+		LOG_ERR("Buffer Pool Possible Duplicate Free");
+	} else if (bph->reserved == BP_MARKER_TAKEN) {
+		bph->reserved = 0;
+	} else {
+		LOG_ERR("Buffer Pool Free Error");
+	}
+#else
 	if (bph->ptr == 0) {
 		LOG_ERR("Buffer Pool Possible Duplicate Free");
 	} else if (bph->ptr == bph) {
@@ -202,11 +1070,121 @@ static void GiveStatHandler(struct bph *bph)
 	} else {
 		LOG_ERR("Buffer Pool Free Error");
 	}
+#endif
 #endif
 
-	bps.space_available += bph->size;
-	bps.cur_allocs -= 1;
+	if (IS_HEAP_BLOCK(bph)) {
+		bps.space_available += bph->size;
+		bps.cur_allocs -= 1;
+	}
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+	GiveSiteHandler(block, bph->size);
+#endif
 
 	k_spin_unlock(&buffer_pool.lock, key);
 }
 #endif
+
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+/* Called with heap lock held */
+static void TakeSiteHandler(uint8_t *block, size_t size,
+			    const char *context)
+{
+	size_t pad = BLOCK_PAD(block);
+	struct bp_track *track = (struct bp_track *)(block - pad);
+	struct bp_site_stats *site = NULL;
+	uint32_t i;
+
+	if (context == NULL) {
+		context = BP_CONTEXT_UNUSED;
+	}
+
+	/* Context is usually __func__, so compare pointers before strings */
+	for (i = 0; i < OTHER_SITE && sites[i].context != NULL; i++) {
+		if (sites[i].context == context ||
+		    strcmp(sites[i].context, context) == 0) {
+			break;
+		}
+	}
+	if (i < OTHER_SITE && sites[i].context == NULL) {
+		sites[i].context = context;
+	} else if (i == OTHER_SITE) {
+		sites[i].context = "other";
+	}
+	site = &sites[i];
+
+	site->live_bytes += size;
+	site->live_count += 1;
+	site->peak_bytes = MAX(site->peak_bytes, site->live_bytes);
+	site->peak_count = MAX(site->peak_count, site->live_count);
+	site->total_allocs += 1;
+
+	track->site = i;
+	track->pad = pad;
+	track->take_ms = k_uptime_get_32();
+	sys_dlist_append(&live_list, &track->node);
+}
+
+/* Called with heap lock held */
+static void GiveSiteHandler(uint8_t *block, size_t size)
+{
+	struct bp_track *track = (struct bp_track *)(block - BLOCK_PAD(block));
+	struct bp_site_stats *site = &sites[track->site];
+
+	site->live_bytes -= size;
+	site->live_count -= 1;
+	sys_dlist_remove(&track->node);
+}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_HEAP_STATS
+/**
+ * @brief Called with heap lock held.  The largest free chunk is in the
+ * highest free list (bucket) that isn't empty, so only that list is read
+ * and at most CONFIG_BUFFER_POOL_HEAP_STATS_SCAN of its chunks.
+ */
+static void HeapStatHandler(struct bp_stats *stats)
+{
+	struct z_heap *h = buffer_pool.heap.heap;
+	struct sys_memory_stats heap_stats;
+	size_t bytes;
+	chunkid_t first;
+	chunkid_t c;
+	int scanned = 0;
+
+	sys_heap_runtime_stats_get(&buffer_pool.heap, &heap_stats);
+	stats->heap_free = heap_stats.free_bytes;
+	stats->heap_used = heap_stats.allocated_bytes;
+	stats->heap_max_used = heap_stats.max_allocated_bytes;
+
+	stats->free_lists = __builtin_popcount(h->avail_buckets);
+	stats->largest_free_chunk = 0;
+	if (h->avail_buckets != 0) {
+		first = h->buckets[find_msb_set(h->avail_buckets) - 1].next;
+		c = first;
+		do {
+			bytes = chunksz_to_bytes(h, chunk_size(h, c));
+			stats->largest_free_chunk =
+				MAX(stats->largest_free_chunk, bytes);
+			c = next_free_chunk(h, c);
+			scanned += 1;
+		} while (c != first &&
+			 scanned < CONFIG_BUFFER_POOL_HEAP_STATS_SCAN);
+	}
+
+	bytes = chunk_header_bytes(h) + BP_BLOCK_OVERHEAD + BP_TRAILER_SIZE;
+	if (stats->largest_free_chunk > bytes) {
+		stats->largest_take = stats->largest_free_chunk - bytes;
+	} else {
+		stats->largest_take = 0;
+	}
+
+	if (stats->heap_free > 0) {
+		stats->fragmentation_percent =
+			100 - (int)((stats->largest_free_chunk * 100) /
+				    stats->heap_free);
+	} else {
+		stats->fragmentation_percent = 0;
+	}
+}
+#endif
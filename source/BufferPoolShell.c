@@ -12,21 +12,73 @@
 /******************************************************************************/
 #include <zephyr/zephyr.h>
 #include <zephyr/shell/shell.h>
+#include <stdlib.h>
 
 #include "BufferPool.h"
+#include "Framework.h"
+#ifdef CONFIG_FWK_TYPE_POOLS
+#include <framework_pools.h>
+#endif
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define AGED_LIST_SIZE 16
+
+/* Buffer message with the default layout (used to report savings) */
+struct default_buf_msg {
+	FwkMsgHeader_t header;
+	size_t size;
+	size_t length;
+};
+
+#define LAYOUT_ROW(t, s) { #t, sizeof(t), (s) }
+
+struct layout_row {
+	const char *name;
+	size_t size;
+	size_t saved;
+};
 
 /******************************************************************************/
 /* Local Function Prototypes                                                  */
 /******************************************************************************/
 static int bp_stats(const struct shell *shell, size_t argc, char **argv);
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+static int bp_sites(const struct shell *shell, size_t argc, char **argv);
+static int bp_aged(const struct shell *shell, size_t argc, char **argv);
+#endif
+#ifdef CONFIG_FWK_TYPE_POOLS
+static int bp_pools(const struct shell *shell, size_t argc, char **argv);
+#endif
+static int bp_layout(const struct shell *shell, size_t argc, char **argv);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+/* sizeof each type (fixed when the image is built) */
+static const struct layout_row layout_rows[] = {
+	LAYOUT_ROW(FwkMsg_t, 0),
+	LAYOUT_ROW(FwkBufMsg_t,
+		   sizeof(struct default_buf_msg) - sizeof(FwkBufMsg_t)),
+	LAYOUT_ROW(FwkCallbackMsg_t, 0),
+};
 
 /******************************************************************************/
 /* Global Function Definitions                                                */
 /******************************************************************************/
-SHELL_STATIC_SUBCMD_SET_CREATE(sub_bp,
-			       SHELL_CMD(stats, NULL, "Print buffer pool stats",
-					 bp_stats),
-			       SHELL_SUBCMD_SET_END);
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	sub_bp, SHELL_CMD(stats, NULL, "Print buffer pool stats", bp_stats),
+	SHELL_COND_CMD(CONFIG_BUFFER_POOL_SITE_STATS, sites, NULL,
+		       "Print buffer pool usage by allocation site", bp_sites),
+	SHELL_COND_CMD_ARG(CONFIG_BUFFER_POOL_SITE_STATS, aged, NULL,
+			   "Print buffers held longer than [ms] (oldest first)",
+			   bp_aged, 1, 1),
+	SHELL_COND_CMD(CONFIG_FWK_TYPE_POOLS, pools, NULL,
+		       "Print message type pool usage", bp_pools),
+	SHELL_CMD(layout, NULL, "Print message sizes and per block overhead",
+		  bp_layout),
+	SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(bp, &sub_bp, "Buffer Pool", NULL);
 
@@ -62,6 +114,44 @@ static int bp_stats(const struct shell *shell, size_t argc, char **argv)
 			    stats.take_failures);
 		shell_print(shell, "last fail size        %d",
 			    stats.last_fail_size);
+#ifdef CONFIG_BUFFER_POOL_ADMISSION
+		shell_print(shell, "pressure level        %d",
+			    BufferPool_GetPressure());
+		shell_print(shell, "rejections            %d",
+			    stats.rejections);
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+		struct bp_quota_stats q;
+		uint16_t id;
+
+		shell_print(shell, "  id     used     peak    quota  failures");
+		for (id = 0; id < BufferPool_GetQuotaIds(); id++) {
+			BufferPool_GetQuotaStats(id, &q);
+			if (q.peak == 0 && q.quota == 0 && q.failures == 0) {
+				continue;
+			}
+			shell_print(shell, "%4u %8u %8u %8u %9u", id, q.used,
+				    q.peak, q.quota, q.failures);
+		}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_HEAP_STATS
+		shell_print(shell, "heap free             %zu",
+			    stats.heap_free);
+		shell_print(shell, "heap used             %zu",
+			    stats.heap_used);
+		shell_print(shell, "heap max used         %zu",
+			    stats.heap_max_used);
+		shell_print(shell, "free lists            %zu",
+			    stats.free_lists);
+		shell_print(shell, "largest free chunk    %zu",
+			    stats.largest_free_chunk);
+		shell_print(shell, "largest take          %zu",
+			    stats.largest_take);
+		shell_print(shell, "fragmentation         %d%%",
+			    stats.fragmentation_percent);
+#endif
 
 #if CONFIG_BUFFER_POOL_WINDOW_SIZE > 0
 		shell_print(shell, "List of recently allocated sizes:");
@@ -77,3 +167,92 @@ static int bp_stats(const struct shell *shell, size_t argc, char **argv)
 	}
 	return 0;
 }
+
+#ifdef CONFIG_BUFFER_POOL_SITE_STATS
+static int bp_sites(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	struct bp_site_stats stats;
+	uint8_t i;
+
+	shell_print(shell, "live bytes  live  peak bytes  peak     total  site");
+	for (i = 0; BufferPool_GetSiteStats(i, &stats) == 0; i++) {
+		shell_print(shell, "%10u %5u %11u %5u %9u  %s",
+			    stats.live_bytes, stats.live_count,
+			    stats.peak_bytes, stats.peak_count,
+			    stats.total_allocs, stats.context);
+	}
+	return 0;
+}
+
+static int bp_aged(const struct shell *shell, size_t argc, char **argv)
+{
+	struct bp_aged_buffer list[AGED_LIST_SIZE];
+	uint32_t min_age_ms = CONFIG_BUFFER_POOL_AGE_THRESHOLD_MS;
+	size_t count;
+	size_t i;
+
+	if (argc > 1) {
+		min_age_ms = strtoul(argv[1], NULL, 0);
+	}
+
+	count = BufferPool_GetAgedBuffers(min_age_ms, list, AGED_LIST_SIZE);
+	shell_print(shell, "Buffers held at least %u ms: %zu", min_age_ms,
+		    count);
+	for (i = 0; i < count; i++) {
+		shell_print(shell, "%p size %zu age %u ms  %s", list[i].buffer,
+			    list[i].size, list[i].age_ms, list[i].context);
+	}
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+static int bp_pools(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	const struct bp_type_pool *p;
+	uint8_t i;
+
+	shell_print(shell, "pool  used  count  block  type");
+	for (i = 0; i < fwk_type_pool_count; i++) {
+		p = &fwk_type_pools[i];
+		shell_print(shell, "%4u %5u %6u %6zu  %s", i + 1,
+			    k_mem_slab_num_used_get(p->slab), p->count,
+			    p->slab->block_size, p->name);
+	}
+	shell_print(shell, "Total size %zu", (size_t)FWK_TYPE_POOLS_SIZE);
+	return 0;
+}
+#endif
+
+static int bp_layout(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	size_t i;
+
+	shell_print(shell, "Block overhead %zu (header %zu track %zu)",
+		    BP_BLOCK_OVERHEAD, BP_HEADER_SIZE, BP_TRACK_SIZE);
+	shell_print(shell, "Compact layout %s",
+		    IS_ENABLED(CONFIG_FWK_COMPACT_MSG) ? "on" : "off");
+	shell_print(shell, " size  saved  type");
+	for (i = 0; i < ARRAY_SIZE(layout_rows); i++) {
+		shell_print(shell, "%5zu %6zu  %s", layout_rows[i].size,
+			    layout_rows[i].saved + BP_HEADER_SAVED,
+			    layout_rows[i].name);
+	}
+#ifdef CONFIG_FWK_TYPE_POOLS
+	for (i = 0; i < fwk_type_pool_count; i++) {
+		shell_print(shell, "%5zu %6zu  %s", fwk_type_pools[i].size,
+			    BP_HEADER_SAVED, fwk_type_pools[i].name);
+	}
+#endif
+	shell_print(shell, "Saved is per message (compared to default layout)");
+	return 0;
+}
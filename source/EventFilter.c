@@ -0,0 +1,375 @@
+/**
+ * @file EventFilter.c
+ * @brief Receives untargeted messages and broadcasts the ones that pass
+ * the rule configured for their message code.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define FWK_FNAME "EventFilter"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr/init.h>
+#include <string.h>
+
+#include "BufferPool.h"
+#include "Framework.h"
+#include "EventFilter.h"
+
+#include <framework_ids.h>
+#include <framework_msgcodes.h>
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+typedef struct RuleEntry {
+	EventFilterRule_t rule;
+	bool inUse;
+	bool arrived;
+	bool above;
+	bool hashValid;
+	uint32_t lastArrivalMs;
+	uint32_t lastPassMs; /** last message that passed debounce */
+	uint32_t windowStartMs;
+	uint16_t windowCount;
+	uint32_t hash;
+	/* Changed when the rule is added or replaced */
+	uint32_t version;
+	EventFilterStats_t stats;
+} RuleEntry_t;
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int EventFilter_Initialize(const struct device *device);
+static void EventFilterThread(void *pArg1, void *pArg2, void *pArg3);
+static bool Filter(FwkMsg_t *pMsg);
+static bool Debounce(RuleEntry_t *pEntry, uint32_t now);
+static bool Deduplicate(RuleEntry_t *pEntry, uint32_t hash);
+static bool Threshold(RuleEntry_t *pEntry, int32_t value);
+static bool RateLimit(RuleEntry_t *pEntry, uint32_t now);
+static uint32_t PayloadHash(const FwkMsg_t *pMsg);
+static RuleEntry_t *FindEntry(FwkMsgCode_t msgCode);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static FwkMsgTask_t filterTask;
+
+K_THREAD_STACK_DEFINE(filterStack, CONFIG_FWK_EVENT_FILTER_STACK_SIZE);
+
+K_MSGQ_DEFINE(filterQueue, FWK_QUEUE_ENTRY_SIZE,
+	      CONFIG_FWK_EVENT_FILTER_QUEUE_DEPTH, FWK_QUEUE_ALIGNMENT);
+
+static RuleEntry_t rules[CONFIG_FWK_EVENT_FILTER_MAX_RULES];
+
+static struct k_spinlock rulesLock;
+
+static uint32_t ruleVersion;
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+SYS_INIT(EventFilter_Initialize, APPLICATION,
+	 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+int EventFilter_AddRule(const EventFilterRule_t *pRule)
+{
+	RuleEntry_t *pEntry;
+	size_t i;
+
+	if (pRule == NULL || pRule->msgCode == FMC_INVALID) {
+		return -EINVAL;
+	}
+	if ((pRule->type & EVENT_FILTER_THRESHOLD) &&
+	    pRule->getValue == NULL) {
+		return -EINVAL;
+	}
+	if ((pRule->type & EVENT_FILTER_RATE_LIMIT) &&
+	    (pRule->rateCount == 0 || pRule->ratePeriodMs == 0)) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&rulesLock);
+
+	pEntry = FindEntry(pRule->msgCode);
+	for (i = 0; pEntry == NULL && i < ARRAY_SIZE(rules); i++) {
+		if (!rules[i].inUse) {
+			pEntry = &rules[i];
+		}
+	}
+	if (pEntry != NULL) {
+		memset(pEntry, 0, sizeof(RuleEntry_t));
+		pEntry->rule = *pRule;
+		pEntry->inUse = true;
+		pEntry->version = ++ruleVersion;
+	}
+
+	k_spin_unlock(&rulesLock, key);
+
+	return (pEntry != NULL) ? 0 : -ENOMEM;
+}
+
+int EventFilter_RemoveRule(FwkMsgCode_t msgCode)
+{
+	k_spinlock_key_t key = k_spin_lock(&rulesLock);
+
+	RuleEntry_t *pEntry = FindEntry(msgCode);
+	if (pEntry != NULL) {
+		pEntry->inUse = false;
+	}
+
+	k_spin_unlock(&rulesLock, key);
+
+	return (pEntry != NULL) ? 0 : -ENOENT;
+}
+
+int EventFilter_GetStats(FwkMsgCode_t msgCode, EventFilterStats_t *pStats)
+{
+	if (pStats == NULL) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&rulesLock);
+
+	RuleEntry_t *pEntry = FindEntry(msgCode);
+	if (pEntry != NULL) {
+		*pStats = pEntry->stats;
+	}
+
+	k_spin_unlock(&rulesLock, key);
+
+	return (pEntry != NULL) ? 0 : -ENOENT;
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int EventFilter_Initialize(const struct device *device)
+{
+	ARG_UNUSED(device);
+
+	/* The filter doesn't have a dispatcher so that it is skipped by
+	 * unicast and broadcast (which would otherwise loop back to it).
+	 */
+	filterTask.rxer.id = FWK_ID_EVENT_FILTER;
+	filterTask.rxer.pQueue = &filterQueue;
+	filterTask.rxer.rxBlockTicks = K_FOREVER;
+	filterTask.rxer.pMsgDispatcher = NULL;
+
+	Framework_RegisterTask(&filterTask);
+
+	filterTask.pTid = k_thread_create(
+		&filterTask.threadData, filterStack,
+		K_THREAD_STACK_SIZEOF(filterStack), EventFilterThread,
+		&filterTask, NULL, NULL, CONFIG_FWK_EVENT_FILTER_PRIORITY, 0,
+		K_NO_WAIT);
+
+	k_thread_name_set(filterTask.pTid, "event_filter");
+
+	return 0;
+}
+
+static void EventFilterThread(void *pArg1, void *pArg2, void *pArg3)
+{
+	FwkMsgTask_t *pMsgTask = (FwkMsgTask_t *)pArg1;
+	FwkMsg_t *pMsg;
+	BaseType_t result;
+
+	ARG_UNUSED(pArg2);
+	ARG_UNUSED(pArg3);
+
+	while (true) {
+		pMsg = NULL;
+		Framework_Receive(pMsgTask->rxer.pQueue, &pMsg,
+				  pMsgTask->rxer.rxBlockTicks);
+		if (pMsg == NULL) {
+			continue;
+		}
+
+		result = FWK_ERROR;
+		if (Filter(pMsg)) {
+			pMsg->header.rxId = FWK_ID_RESERVED;
+			result = Framework_Broadcast(pMsg,
+						     BufferPool_GetSize(pMsg));
+		}
+
+		/* Broadcast frees the original message on success */
+		if (result != FWK_SUCCESS) {
+			Framework_FreeMsg(pMsg);
+		}
+	}
+}
+
+/**
+ * @brief The payload hash and the value are computed from a copy of the
+ * rule without the lock (getValue is application code).  The rule state
+ * is then updated with the lock held.  If the rule was replaced in
+ * between, the message is checked again.
+ *
+ * @retval true if message should be forwarded
+ */
+static bool Filter(FwkMsg_t *pMsg)
+{
+	EventFilterRule_t rule;
+	RuleEntry_t *pEntry;
+	uint32_t version;
+	uint32_t now = k_uptime_get_32();
+	uint32_t hash = 0;
+	int32_t value = 0;
+	bool forward = true;
+	k_spinlock_key_t key;
+
+	do {
+		key = k_spin_lock(&rulesLock);
+		pEntry = FindEntry(pMsg->header.msgCode);
+		if (pEntry != NULL) {
+			rule = pEntry->rule;
+			version = pEntry->version;
+		}
+		k_spin_unlock(&rulesLock, key);
+
+		if (pEntry == NULL) {
+			return true;
+		}
+
+		if (rule.type & EVENT_FILTER_DEDUPLICATE) {
+			hash = PayloadHash(pMsg);
+		}
+		if (rule.type & EVENT_FILTER_THRESHOLD) {
+			value = rule.getValue(pMsg);
+		}
+
+		key = k_spin_lock(&rulesLock);
+		pEntry = FindEntry(pMsg->header.msgCode);
+		if (pEntry == NULL || pEntry->version == version) {
+			break;
+		}
+		k_spin_unlock(&rulesLock, key);
+	} while (true);
+
+	/* The rule may have been removed while the message was checked */
+	if (pEntry != NULL) {
+		uint8_t type = pEntry->rule.type;
+
+		if (type & EVENT_FILTER_DEBOUNCE) {
+			forward = Debounce(pEntry, now);
+		}
+		if (forward && (type & EVENT_FILTER_DEDUPLICATE)) {
+			forward = Deduplicate(pEntry, hash);
+		}
+		if (forward && (type & EVENT_FILTER_THRESHOLD)) {
+			forward = Threshold(pEntry, value);
+		}
+		if (forward && (type & EVENT_FILTER_RATE_LIMIT)) {
+			forward = RateLimit(pEntry, now);
+		}
+
+		if (forward) {
+			/* Only forwarded messages update the duplicate check */
+			if (type & EVENT_FILTER_DEDUPLICATE) {
+				pEntry->hash = hash;
+				pEntry->hashValid = true;
+			}
+			pEntry->stats.forwarded += 1;
+		} else {
+			pEntry->stats.dropped += 1;
+		}
+	}
+
+	k_spin_unlock(&rulesLock, key);
+
+	return forward;
+}
+
+static bool Debounce(RuleEntry_t *pEntry, uint32_t now)
+{
+	bool quiet = !pEntry->arrived ||
+		     ((now - pEntry->lastArrivalMs) >= pEntry->rule.debounceMs);
+
+	/* A stream that never goes quiet is still forwarded periodically */
+	if (!quiet && pEntry->rule.debounceMaxMs > 0) {
+		quiet = ((now - pEntry->lastPassMs) >=
+			 pEntry->rule.debounceMaxMs);
+	}
+
+	/* Every arrival restarts the quiet period */
+	pEntry->arrived = true;
+	pEntry->lastArrivalMs = now;
+	if (quiet) {
+		pEntry->lastPassMs = now;
+	}
+
+	return quiet;
+}
+
+static bool Deduplicate(RuleEntry_t *pEntry, uint32_t hash)
+{
+	return !pEntry->hashValid || (pEntry->hash != hash);
+}
+
+static bool Threshold(RuleEntry_t *pEntry, int32_t value)
+{
+	int32_t rearm = pEntry->rule.threshold - pEntry->rule.hysteresis;
+
+	if (!pEntry->above && value >= pEntry->rule.threshold) {
+		pEntry->above = true;
+		return true;
+	} else if (pEntry->above && value < rearm) {
+		pEntry->above = false;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+static bool RateLimit(RuleEntry_t *pEntry, uint32_t now)
+{
+	if ((pEntry->windowCount == 0) ||
+	    ((now - pEntry->windowStartMs) >= pEntry->rule.ratePeriodMs)) {
+		pEntry->windowStartMs = now;
+		pEntry->windowCount = 0;
+	}
+
+	if (pEntry->windowCount < pEntry->rule.rateCount) {
+		pEntry->windowCount += 1;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+/* FNV-1a of everything after the header */
+static uint32_t PayloadHash(const FwkMsg_t *pMsg)
+{
+	const uint8_t *p = (const uint8_t *)pMsg;
+	size_t size = BufferPool_GetSize(pMsg);
+	uint32_t hash = FNV_OFFSET_BASIS;
+	size_t i;
+
+	for (i = sizeof(FwkMsgHeader_t); i < size; i++) {
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static RuleEntry_t *FindEntry(FwkMsgCode_t msgCode)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(rules); i++) {
+		if (rules[i].inUse && rules[i].rule.msgCode == msgCode) {
+			return &rules[i];
+		}
+	}
+
+	return NULL;
+}
@@ -10,7 +10,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include <zephyr/logging/log.h>
+#include "FrameworkOs.h"
 LOG_MODULE_REGISTER(framework, CONFIG_FRAMEWORK_LOG_LEVEL);
 
 #define FWK_FNAME "Framework"
@@ -18,12 +18,31 @@ LOG_MODULE_REGISTER(framework, CONFIG_FRAMEWORK_LOG_LEVEL);
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
-#include <zephyr/init.h>
 #include <string.h>
 
 #include "BufferPool.h"
 #include "Framework.h"
 
+#ifdef CONFIG_FWK_SEG_MSG
+#include "FrameworkSegMsg.h"
+#endif
+
+#ifdef CONFIG_FWK_NET_BUF_MSG
+#include "FrameworkNetBuf.h"
+#endif
+
+#ifdef CONFIG_FWK_RECORD
+#include "FrameworkRecord.h"
+#endif
+
+#ifdef CONFIG_FWK_ASYNC
+#include "FrameworkAsync.h"
+#endif
+
+#ifdef CONFIG_FWK_TRAFFIC
+#include "FrameworkTraffic.h"
+#endif
+
 #ifdef CONFIG_FWK_AUTO_GENERATE_FILES
 #include <framework_ids.h>
 #include <framework_msgcodes.h>
@@ -32,11 +51,20 @@ LOG_MODULE_REGISTER(framework, CONFIG_FRAMEWORK_LOG_LEVEL);
 /******************************************************************************/
 /* Local Constant, Macro and Type Definitions                                 */
 /******************************************************************************/
+/* Senders read the registry without a lock.  A sender increments refs
+ * before it reads the receiver pointer and decrements it after the message
+ * is queued.  Unregister clears the pointer, sets REFS_CLOSED so that new
+ * senders can't take a reference, and then waits for refs to reach zero.
+ * After that, every message that was queued to the receiver is in its
+ * queue.
+ */
 typedef struct MsgTaskArrayEntry {
-	FwkMsgReceiver_t *pMsgReceiver;
-	bool inUse;
+	atomic_ptr_t pMsgReceiver;
+	atomic_t refs;
 } MsgTaskArrayEntry_t;
 
+#define REFS_CLOSED BIT(30)
+
 /* When generating IDs the total number is known. */
 #ifdef CONFIG_FWK_AUTO_GENERATE_FILES
 #define MAX_MSG_RECEIVERS __FRAMEWORK_MAX_MSG_RECEIVERS
@@ -44,6 +72,20 @@ typedef struct MsgTaskArrayEntry {
 #define MAX_MSG_RECEIVERS CONFIG_FWK_MAX_MSG_RECEIVERS
 #endif
 
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+/* A route is the message code and receiver ID packed into an atomic.
+ * Zero is an empty entry (FMC_INVALID is never cached).
+ */
+#define ROUTE_PACK(c, i) ((atomic_val_t)(((uint32_t)(c) << 16) | (i)))
+#define ROUTE_CODE(r) ((FwkMsgCode_t)((uint32_t)(r) >> 16))
+#define ROUTE_ID(r) ((FwkId_t)((uint32_t)(r)&0xFFFF))
+#define ROUTE_CACHE_MASK (CONFIG_FWK_UNICAST_CACHE_SIZE - 1)
+#define ROUTE_CACHE_PROBES MIN(4, CONFIG_FWK_UNICAST_CACHE_SIZE)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_FWK_UNICAST_CACHE_SIZE),
+	     "Unicast cache size must be a power of two");
+#endif
+
 /* Zero isn't allowed as a valid message code */
 BUILD_ASSERT(FMC_INVALID == 0, "Invalid framework message code configuration");
 
@@ -54,8 +96,65 @@ static int Framework_Initialize(const struct device *device);
 
 static void PeriodicTimerCallbackIsr(struct k_timer *pArg);
 
+static FwkMsg_t *CopyMsg(const FwkMsg_t *pMsg, size_t MsgSize);
+
+static FwkMsgReceiver_t *AcquireReceiver(FwkId_t RxId);
+static void ReleaseReceiver(FwkId_t RxId);
+static BaseType_t ReceiveMsg(FwkQueue_t *pQueue, FwkMsg_t **ppMsg,
+			     TickType_t BlockTicks);
+static size_t FlushQueue(FwkMsgReceiver_t *pMsgRxer);
+static BaseType_t QueueToReceiver(FwkMsgReceiver_t *pMsgRxer,
+				  FwkMsg_t *pMsg);
+
+#ifdef CONFIG_FWK_MSG_PRIORITY
+static bool Boost(FwkMsgReceiver_t *pMsgRxer, FwkMsg_t *pMsg);
+static void Unboost(FwkMsgReceiver_t *pMsgRxer);
+static void UnboostReceived(FwkQueue_t *pQueue, FwkMsg_t *pMsg);
+#endif
+
+#ifdef CONFIG_FWK_WORK_RECEIVER
+static void WorkReceiverHandler(struct k_work *pWork);
+#endif
+
+static DispatchResult_t CallHandler(FwkMsgReceiver_t *pRxer, FwkMsg_t *pMsg);
+
+#if defined(CONFIG_FWK_LIVENESS) || defined(CONFIG_FWK_MSG_PRIORITY)
+static FwkMsgReceiver_t *AcquireQueueOwner(FwkQueue_t *pQueue, FwkId_t Hint,
+					   FwkId_t *pId);
+#endif
+
+#ifdef CONFIG_FWK_LIVENESS
+static uint32_t LivenessNow(void);
+static void LivenessQueued(FwkQueue_t *pQueue, FwkId_t Hint,
+			   uint32_t QueuedMs);
+static void LivenessReceived(FwkQueue_t *pQueue, FwkId_t Hint);
+#endif
+
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+static bool RouteLookup(FwkMsg_t *pMsg, BaseType_t *pResult);
+static void RouteInsert(FwkMsgCode_t Code, FwkId_t RxId,
+			atomic_val_t Generation);
+static void RouteInvalidate(void);
+#endif
+
 static MsgTaskArrayEntry_t msgTaskRegistry[MAX_MSG_RECEIVERS];
 
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+static atomic_t routeCache[CONFIG_FWK_UNICAST_CACHE_SIZE];
+/* Incremented when the registry changes (see RouteInsert) */
+static atomic_t routeGeneration;
+#endif
+
+#ifdef CONFIG_FWK_WORK_RECEIVER
+static struct k_work_q fwkWorkQ;
+
+K_THREAD_STACK_DEFINE(fwkWorkQStack, CONFIG_FWK_WORK_Q_STACK_SIZE);
+#endif
+
+#ifdef CONFIG_FWK_MSG_PRIORITY
+static struct k_spinlock priorityLock;
+#endif
+
 /******************************************************************************/
 /* Global Function Definitions                                                */
 /******************************************************************************/
@@ -72,18 +171,89 @@ void Framework_RegisterReceiver(FwkMsgReceiver_t *pRxer)
 		return;
 	}
 
-	int key = irq_lock();
-	{
-		/* Waste some memory (ids are constant)
-		 * so that a for loop isn't required to look up msg task in table. */
-		if (!msgTaskRegistry[pRxer->id].inUse) {
-			msgTaskRegistry[pRxer->id].inUse = true;
-			msgTaskRegistry[pRxer->id].pMsgReceiver = pRxer;
-		} else {
-			FRAMEWORK_ASSERT(FORCED);
+	/* Waste some memory (ids are constant)
+	 * so that a for loop isn't required to look up msg task in table. */
+	if (!atomic_ptr_cas(&msgTaskRegistry[pRxer->id].pMsgReceiver, NULL,
+			    pRxer)) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	/* Allow references again (after an unregister) */
+	atomic_and(&msgTaskRegistry[pRxer->id].refs, ~REFS_CLOSED);
+
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+	/* A lower ID may now handle a code that was cached */
+	RouteInvalidate();
+#endif
+}
+
+int Framework_UnregisterReceiver(FwkMsgReceiver_t *pRxer)
+{
+	MsgTaskArrayEntry_t *pEntry;
+	int waitedMs = 0;
+
+	if (pRxer == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+	if (pRxer->id >= MAX_MSG_RECEIVERS) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+	if (Framework_InterruptContext()) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+
+	pEntry = &msgTaskRegistry[pRxer->id];
+	if (!atomic_ptr_cas(&pEntry->pMsgReceiver, pRxer, NULL)) {
+		return -ENOENT;
+	}
+
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+	RouteInvalidate();
+#endif
+
+	/* Senders only hold a reference while queueing (without blocking),
+	 * but a sender can be preempted for longer than the timeout.
+	 */
+	atomic_or(&pEntry->refs, REFS_CLOSED);
+	while (atomic_get(&pEntry->refs) != REFS_CLOSED) {
+		if (waitedMs >= CONFIG_FWK_UNREGISTER_TIMEOUT_MS) {
+			LOG_ERR("Receiver %u is still referenced", pRxer->id);
+			atomic_and(&pEntry->refs, ~REFS_CLOSED);
+			(void)atomic_ptr_cas(&pEntry->pMsgReceiver, NULL,
+					     pRxer);
+			return -ETIMEDOUT;
 		}
+		k_msleep(1);
+		waitedMs += 1;
+	}
+
+#ifdef CONFIG_FWK_WORK_RECEIVER
+	/* Wait for a dispatch in progress to finish */
+	if (pRxer->pWork != NULL) {
+		struct k_work_sync sync;
+
+		k_work_cancel_sync(pRxer->pWork, &sync);
+	}
+#endif
+
+	return FlushQueue(pRxer);
+}
+
+int Framework_UnregisterTask(FwkMsgTask_t *pMsgTask)
+{
+	if (pMsgTask == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
 	}
-	irq_unlock(key);
+
+	/* Prevent periodic messages from being sent to a departed task */
+	k_timer_stop(&pMsgTask->timer);
+
+	return Framework_UnregisterReceiver(&pMsgTask->rxer);
 }
 
 void Framework_RegisterTask(FwkMsgTask_t *pMsgTask)
@@ -97,6 +267,20 @@ void Framework_RegisterTask(FwkMsgTask_t *pMsgTask)
 	k_timer_init(&pMsgTask->timer, PeriodicTimerCallbackIsr, NULL);
 }
 
+#ifdef CONFIG_FWK_WORK_RECEIVER
+void Framework_RegisterWorkReceiver(FwkWorkReceiver_t *pWorkRxer)
+{
+	if (pWorkRxer == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	k_work_init(&pWorkRxer->work, WorkReceiverHandler);
+	pWorkRxer->rxer.pWork = &pWorkRxer->work;
+	Framework_RegisterReceiver(&pWorkRxer->rxer);
+}
+#endif
+
 BaseType_t Framework_Send(FwkId_t RxId, FwkMsg_t *pMsg)
 {
 	BaseType_t result = FWK_ERROR;
@@ -109,15 +293,13 @@ BaseType_t Framework_Send(FwkId_t RxId, FwkMsg_t *pMsg)
 		FRAMEWORK_ASSERT(FORCED);
 		return result;
 	}
-	if (!msgTaskRegistry[RxId].inUse) {
-		FRAMEWORK_ASSERT(FORCED);
-		return result;
-	}
 
-	FwkMsgReceiver_t *pMsgRxer = msgTaskRegistry[RxId].pMsgReceiver;
+	/* The receiver may not be registered (or may have been unregistered) */
+	FwkMsgReceiver_t *pMsgRxer = AcquireReceiver(RxId);
 	if (pMsgRxer != NULL) {
 		pMsg->header.rxId = RxId;
-		result = Framework_Queue(pMsgRxer->pQueue, &pMsg, K_NO_WAIT);
+		result = QueueToReceiver(pMsgRxer, pMsg);
+		ReleaseReceiver(RxId);
 	}
 	return result;
 }
@@ -131,11 +313,23 @@ BaseType_t Framework_Unicast(FwkMsg_t *pMsg)
 		return result;
 	}
 
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+	atomic_val_t generation = atomic_get(&routeGeneration);
+
+	if (RouteLookup(pMsg, &result)) {
+		return result;
+	}
+#endif
+
 	uint32_t i;
 	for (i = FWK_ID_APP_START; i < MAX_MSG_RECEIVERS; i++) {
-		FwkMsgReceiver_t *pMsgRxer = msgTaskRegistry[i].pMsgReceiver;
+		FwkMsgReceiver_t *pMsgRxer = AcquireReceiver(i);
+
+		if (pMsgRxer == NULL) {
+			continue;
+		}
 
-		if (pMsgRxer != NULL && pMsgRxer->pMsgDispatcher != NULL) {
+		if (pMsgRxer->pMsgDispatcher != NULL) {
 			/* The handler isn't called here.
 			 * It is only used to find the task the message belongs to.
 			 */
@@ -145,11 +339,18 @@ BaseType_t Framework_Unicast(FwkMsg_t *pMsg)
 			/* If there is a dispatcher, then send the message to that task. */
 			if (msgHandler != NULL) {
 				pMsg->header.rxId = pMsgRxer->id;
-				result = Framework_Queue(pMsgRxer->pQueue,
-							 &pMsg, K_NO_WAIT);
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+				/* Can't access message after it is queued */
+				RouteInsert(pMsg->header.msgCode, i,
+					    generation);
+#endif
+				result = QueueToReceiver(pMsgRxer, pMsg);
+				ReleaseReceiver(i);
 				break;
 			}
 		}
+
+		ReleaseReceiver(i);
 	}
 
 	return result;
@@ -178,9 +379,13 @@ int Framework_Broadcast(FwkMsg_t *pMsg, size_t MsgSize)
 #endif
 
 	for (i = FWK_ID_APP_START; i < MAX_MSG_RECEIVERS; i++) {
-		pMsgRxer = msgTaskRegistry[i].pMsgReceiver;
+		pMsgRxer = AcquireReceiver(i);
+
+		if (pMsgRxer == NULL) {
+			continue;
+		}
 
-		if (pMsgRxer != NULL && pMsgRxer->pMsgDispatcher != NULL) {
+		if (pMsgRxer->pMsgDispatcher != NULL) {
 			/* The handler isn't called here.  It is only used to determine
 			 * if a task should receive a broadcast message.
 			 */
@@ -201,20 +406,20 @@ int Framework_Broadcast(FwkMsg_t *pMsg, size_t MsgSize)
 			 * then create a copy of the message and place it on the queue.
 			 */
 			if (msgHandler != NULL && accept) {
-				pNewMsg = BufferPool_TryToTake(MsgSize, __func__);
+				pNewMsg = CopyMsg(pMsg, MsgSize);
 				if (pNewMsg != NULL) {
-					memcpy(pNewMsg, pMsg, MsgSize);
 					pNewMsg->header.rxId = pMsgRxer->id;
-					result = Framework_Queue(
-						pMsgRxer->pQueue, &pNewMsg,
-						K_NO_WAIT);
+					result = QueueToReceiver(pMsgRxer,
+								 pNewMsg);
 
 					if (result != FWK_SUCCESS) {
-						BufferPool_Free(pNewMsg);
+						Framework_FreeMsg(pNewMsg);
 					}
 				}
 			}
 		}
+
+		ReleaseReceiver(i);
 	}
 
 	/* Free Original Message Memory only when all messages were routed.
@@ -222,7 +427,7 @@ int Framework_Broadcast(FwkMsg_t *pMsg, size_t MsgSize)
 	 * application code when the result returned is FWK_ERROR.
 	 */
 	if (result == FWK_SUCCESS) {
-		BufferPool_Free(pMsg);
+		Framework_FreeMsg(pMsg);
 	}
 
 	return result;
@@ -234,6 +439,13 @@ BaseType_t Framework_Queue(FwkQueue_t *pQueue, void *ppData,
 	BaseType_t status;
 	FwkMsg_t *pMsg;
 	struct k_msgq_attrs attrs;
+#ifdef CONFIG_FWK_LIVENESS
+	FwkId_t rxId;
+	uint32_t queuedMs;
+#endif
+#ifdef CONFIG_FWK_RECORD
+	FwkRecordCapture_t capture;
+#endif
 
 	if (pQueue == NULL) {
 		FRAMEWORK_ASSERT(FORCED);
@@ -256,6 +468,17 @@ BaseType_t Framework_Queue(FwkQueue_t *pQueue, void *ppData,
 		return FWK_ERROR;
 	}
 
+#ifdef CONFIG_FWK_RECORD
+	/* The message can't be accessed after it is queued */
+	FwkRecord_Capture(pMsg, &capture);
+#endif
+
+#ifdef CONFIG_FWK_LIVENESS
+	rxId = pMsg->header.rxId;
+	queuedMs = LivenessNow();
+	pMsg->header.queuedMs = queuedMs;
+#endif
+
 	if (Framework_InterruptContext()) {
 		status = k_msgq_put(pQueue, ppData, K_NO_WAIT);
 	} else {
@@ -269,12 +492,24 @@ BaseType_t Framework_Queue(FwkQueue_t *pQueue, void *ppData,
 			attrs.used_msgs, attrs.max_msgs, status);
 	}
 
+#ifdef CONFIG_FWK_LIVENESS
+	if (status == 0) {
+		LivenessQueued(pQueue, rxId, queuedMs);
+	}
+#endif
+
+#ifdef CONFIG_FWK_RECORD
+	FwkRecord_Commit(&capture, status);
+#endif
+
 	return status;
 }
 
 BaseType_t Framework_Receive(FwkQueue_t *pQueue, void *ppData,
 			     TickType_t BlockTicks)
 {
+	BaseType_t status;
+
 	if (pQueue == NULL) {
 		FRAMEWORK_ASSERT(FORCED);
 		return FWK_ERROR;
@@ -285,11 +520,16 @@ BaseType_t Framework_Receive(FwkQueue_t *pQueue, void *ppData,
 		return FWK_ERROR;
 	}
 
-	if (Framework_InterruptContext()) {
-		return k_msgq_get(pQueue, ppData, K_NO_WAIT);
-	} else {
-		return k_msgq_get(pQueue, ppData, BlockTicks);
+	status = ReceiveMsg(pQueue, (FwkMsg_t **)ppData, BlockTicks);
+
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	/* The caller handles the message (it isn't dispatched) */
+	if (status == 0) {
+		UnboostReceived(pQueue, *((FwkMsg_t **)ppData));
 	}
+#endif
+
+	return status;
 }
 
 void Framework_StartTimer(FwkMsgTask_t *pMsgTask)
@@ -334,64 +574,425 @@ void Framework_MsgReceiver(FwkMsgReceiver_t *pRxer)
 		return;
 	}
 
-	DispatchResult_t result = DISPATCH_ERROR;
 	FwkMsg_t *pMsg = NULL;
 
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	/* Senders can't boost the thread until its priority is known */
+	if (atomic_ptr_get(&pRxer->tid) == NULL) {
+		pRxer->basePriority = k_thread_priority_get(k_current_get());
+		pRxer->boostPriority = pRxer->basePriority;
+		atomic_ptr_set(&pRxer->tid, k_current_get());
+	}
+#endif
+
 	BaseType_t status =
-		Framework_Receive(pRxer->pQueue, &pMsg, pRxer->rxBlockTicks);
+		ReceiveMsg(pRxer->pQueue, &pMsg, pRxer->rxBlockTicks);
 
 	if ((status == FWK_SUCCESS) && (pMsg != NULL)) {
-		FwkMsgHandler_t *msgHandler =
-			pRxer->pMsgDispatcher(pMsg->header.msgCode);
-		if (msgHandler != NULL) {
-			result = msgHandler(pRxer, pMsg);
-			if (pMsg->header.options & FWK_MSG_OPTION_CALLBACK) {
-				FwkCallbackMsg_t *pCbMsg =
-					(FwkCallbackMsg_t *)pMsg;
-				if (pCbMsg->callback != NULL) {
-					pCbMsg->callback(pCbMsg->data);
-				}
-			}
-		} else {
-			result = Framework_UnknownMsgHandler(pRxer, pMsg);
-		}
+		Framework_DispatchMsg(pRxer, pMsg);
+	}
+}
 
-		if (result != DISPATCH_DO_NOT_FREE) {
-			BufferPool_Free(pMsg);
+void Framework_DispatchMsg(FwkMsgReceiver_t *pRxer, FwkMsg_t *pMsg)
+{
+	DispatchResult_t result = DISPATCH_ERROR;
+
+	if (pRxer == NULL || pMsg == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	/* Handler may free (or send) the message */
+	bool boosted = (pMsg->header.options & FWK_MSG_OPTION_BOOSTED);
+
+	pMsg->header.options &= ~FWK_MSG_OPTION_BOOSTED;
+#endif
+
+#ifdef CONFIG_FWK_ASYNC
+	/* A reply resumes the continuation of its request */
+	if (!FwkAsync_Resume(pRxer, pMsg, &result)) {
+		result = CallHandler(pRxer, pMsg);
+	}
+#else
+	result = CallHandler(pRxer, pMsg);
+#endif
+
+	if (result != DISPATCH_DO_NOT_FREE) {
+		Framework_FreeMsg(pMsg);
+	}
+
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	if (boosted) {
+		Unboost(pRxer);
+	}
+#endif
+
+#ifdef CONFIG_FWK_ASYNC
+	FwkAsync_Expire(pRxer);
+#endif
+
+#ifdef CONFIG_FWK_SCRATCH
+	if (pRxer->pScratch != NULL) {
+		pRxer->pScratch->used = 0;
+	}
+#endif
+}
+
+#ifdef CONFIG_FWK_SCRATCH
+void *Framework_ScratchAlloc(FwkMsgReceiver_t *pRxer, size_t Size)
+{
+	FwkScratch_t *pScratch;
+	size_t start;
+
+	if (pRxer == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+	pScratch = pRxer->pScratch;
+	if (pScratch == NULL) {
+		return NULL;
+	}
+
+	start = ROUND_UP(pScratch->used, FWK_SCRATCH_ALIGN);
+	if (start > pScratch->size || Size > (pScratch->size - start)) {
+		LOG_WRN("Scratch arena of %u is too small", pRxer->id);
+		return NULL;
+	}
+
+	pScratch->used = start + Size;
+	pScratch->peak = MAX(pScratch->peak, pScratch->used);
+
+	return pScratch->pBase + start;
+}
+#endif
+
+void Framework_ForEachReceiver(FwkReceiverIterator_t Iterator,
+			       void *pContext)
+{
+	FwkMsgReceiver_t *pMsgRxer;
+	uint32_t i;
+
+	if (Iterator == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	for (i = 0; i < MAX_MSG_RECEIVERS; i++) {
+		pMsgRxer = AcquireReceiver(i);
+		if (pMsgRxer != NULL) {
+			Iterator(pMsgRxer, pContext);
+			ReleaseReceiver(i);
 		}
 	}
 }
 
 BaseType_t Framework_QueueIsEmpty(FwkId_t RxId)
 {
+	BaseType_t empty = 1;
+
 	if (RxId >= MAX_MSG_RECEIVERS) {
-		return 1;
-	}
-	if (!msgTaskRegistry[RxId].inUse) {
-		return 1;
+		return empty;
 	}
 
-	FwkQueue_t *pQueue = msgTaskRegistry[RxId].pMsgReceiver->pQueue;
-	return ((k_msgq_num_used_get(pQueue) == 0) ? 1 : 0);
+	FwkMsgReceiver_t *pMsgRxer = AcquireReceiver(RxId);
+	if (pMsgRxer != NULL) {
+		empty = (k_msgq_num_used_get(pMsgRxer->pQueue) == 0) ? 1 : 0;
+		ReleaseReceiver(RxId);
+	}
+	return empty;
 }
 
 size_t Framework_Flush(FwkId_t RxId)
 {
+	size_t purged = 0;
+
 	if (RxId >= MAX_MSG_RECEIVERS) {
-		return 0;
+		return purged;
+	}
+
+	FwkMsgReceiver_t *pMsgRxer = AcquireReceiver(RxId);
+	if (pMsgRxer != NULL) {
+		purged = FlushQueue(pMsgRxer);
+		ReleaseReceiver(RxId);
+	}
+	return purged;
+}
+
+void Framework_FreeMsg(FwkMsg_t *pMsg)
+{
+	if (pMsg == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
 	}
-	if (!msgTaskRegistry[RxId].inUse) {
-		return 0;
+
+#ifdef CONFIG_FWK_SEG_MSG
+	if (pMsg->header.options & FWK_MSG_OPTION_SEGMENTED) {
+		FwkSegMsg_Free((FwkSegMsg_t *)pMsg);
+		return;
 	}
+#endif
+
+#ifdef CONFIG_FWK_NET_BUF_MSG
+	if (pMsg->header.options & FWK_MSG_OPTION_NET_BUF) {
+		FwkNetBufMsg_Free((FwkNetBufMsg_t *)pMsg);
+		return;
+	}
+#endif
+
+	BufferPool_Free(pMsg);
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+#if defined(CONFIG_FWK_LIVENESS) || defined(CONFIG_FWK_MSG_PRIORITY)
+/**
+ * @brief Find the registered receiver that owns a queue.  The ID of a
+ * routed message is checked first.  A message that was put on a queue
+ * with Framework_Queue may not have the ID of the receiver.
+ */
+static FwkMsgReceiver_t *AcquireQueueOwner(FwkQueue_t *pQueue, FwkId_t Hint,
+					   FwkId_t *pId)
+{
+	FwkMsgReceiver_t *pMsgRxer;
+	uint32_t i;
+
+	if (Hint < MAX_MSG_RECEIVERS) {
+		pMsgRxer = AcquireReceiver(Hint);
+		if (pMsgRxer != NULL) {
+			if (pMsgRxer->pQueue == pQueue) {
+				*pId = Hint;
+				return pMsgRxer;
+			}
+			ReleaseReceiver(Hint);
+		}
+	}
+
+	for (i = 0; i < MAX_MSG_RECEIVERS; i++) {
+		pMsgRxer = AcquireReceiver(i);
+		if (pMsgRxer != NULL) {
+			if (pMsgRxer->pQueue == pQueue) {
+				*pId = i;
+				return pMsgRxer;
+			}
+			ReleaseReceiver(i);
+		}
+	}
+
+	return NULL;
+}
+#endif
 
+#ifdef CONFIG_FWK_LIVENESS
+/* Zero means the receiver isn't waiting */
+static uint32_t LivenessNow(void)
+{
+	uint32_t now = k_uptime_get_32();
+
+	return (now != 0) ? now : 1;
+}
+
+/**
+ * @brief Only the first message waiting sets the time.  A receiver with a
+ * higher priority can take the message (and find its queue empty) before
+ * the put returns, so the time is cleared again if the queue is empty.
+ */
+static void LivenessQueued(FwkQueue_t *pQueue, FwkId_t Hint,
+			   uint32_t QueuedMs)
+{
+	FwkMsgReceiver_t *pMsgRxer;
+	FwkId_t id;
+
+	pMsgRxer = AcquireQueueOwner(pQueue, Hint, &id);
+	if (pMsgRxer != NULL) {
+		if (atomic_cas(&pMsgRxer->waitingMs, 0, QueuedMs) &&
+		    k_msgq_num_used_get(pQueue) == 0) {
+			atomic_cas(&pMsgRxer->waitingMs, QueuedMs, 0);
+		}
+		ReleaseReceiver(id);
+	}
+}
+
+/**
+ * @brief Count a message that was removed from a queue and set the
+ * waiting time to the enqueue time of the new head.  Clear first so that
+ * a message queued after the peek sets the time.  Only the receiver
+ * removes messages, so the head can't be freed while it is read.
+ */
+static void LivenessReceived(FwkQueue_t *pQueue, FwkId_t Hint)
+{
+	FwkMsgReceiver_t *pMsgRxer;
+	FwkMsg_t *pHead = NULL;
+	FwkId_t id;
+
+	pMsgRxer = AcquireQueueOwner(pQueue, Hint, &id);
+	if (pMsgRxer == NULL) {
+		return;
+	}
+
+	atomic_inc(&pMsgRxer->progress);
+	atomic_set(&pMsgRxer->waitingMs, 0);
+	if (k_msgq_peek(pQueue, &pHead) == 0 && pHead != NULL) {
+		atomic_set(&pMsgRxer->waitingMs, pHead->header.queuedMs);
+	}
+
+	ReleaseReceiver(id);
+}
+#endif
+
+static DispatchResult_t CallHandler(FwkMsgReceiver_t *pRxer, FwkMsg_t *pMsg)
+{
+	DispatchResult_t result;
+
+	FwkMsgHandler_t *msgHandler =
+		pRxer->pMsgDispatcher(pMsg->header.msgCode);
+	if (msgHandler != NULL) {
+		result = msgHandler(pRxer, pMsg);
+		if (pMsg->header.options & FWK_MSG_OPTION_CALLBACK) {
+			FwkCallbackMsg_t *pCbMsg = (FwkCallbackMsg_t *)pMsg;
+			if (pCbMsg->callback != NULL) {
+				pCbMsg->callback(pCbMsg->data);
+			}
+		}
+	} else {
+		result = Framework_UnknownMsgHandler(pRxer, pMsg);
+	}
+
+	return result;
+}
+
+/**
+ * @brief Initialize buffer pool (statistics).
+ */
+static int Framework_Initialize(const struct device *device)
+{
+	ARG_UNUSED(device);
+
+	BufferPool_Initialize();
+
+#ifdef CONFIG_FWK_WORK_RECEIVER
+	k_work_queue_start(&fwkWorkQ, fwkWorkQStack,
+			   K_THREAD_STACK_SIZEOF(fwkWorkQStack),
+			   CONFIG_FWK_WORK_Q_PRIORITY, NULL);
+	k_thread_name_set(&fwkWorkQ.thread, "fwk_work_q");
+#endif
+
+	return 0;
+}
+
+/**
+ * @brief Copy a message for broadcast.  Messages that own other buffers
+ * need a deep copy so that each receiver can free its copy.
+ */
+static FwkMsg_t *CopyMsg(const FwkMsg_t *pMsg, size_t MsgSize)
+{
+	FwkMsg_t *pNewMsg;
+
+#ifdef CONFIG_FWK_SEG_MSG
+	if (pMsg->header.options & FWK_MSG_OPTION_SEGMENTED) {
+		return (FwkMsg_t *)FwkSegMsg_Clone((const FwkSegMsg_t *)pMsg);
+	}
+#endif
+
+#ifdef CONFIG_FWK_NET_BUF_MSG
+	if (pMsg->header.options & FWK_MSG_OPTION_NET_BUF) {
+		return (FwkMsg_t *)FwkNetBufMsg_Clone(
+			(const FwkNetBufMsg_t *)pMsg);
+	}
+#endif
+
+#ifdef CONFIG_BUFFER_POOL_QUOTAS
+	/* Broadcast copies are charged to the sender */
+	pNewMsg = BufferPool_TryToTakeId(MsgSize, pMsg->header.txId, __func__);
+#else
+	pNewMsg = BufferPool_TryToTake(MsgSize, __func__);
+#endif
+	if (pNewMsg != NULL) {
+		memcpy(pNewMsg, pMsg, MsgSize);
+	}
+
+	return pNewMsg;
+}
+
+/**
+ * @brief Take a reference to a registered receiver.
+ *
+ * @retval NULL if the receiver isn't registered, otherwise the reference
+ * must be released with ReleaseReceiver.
+ */
+static FwkMsgReceiver_t *AcquireReceiver(FwkId_t RxId)
+{
+	MsgTaskArrayEntry_t *pEntry = &msgTaskRegistry[RxId];
+	FwkMsgReceiver_t *pMsgRxer;
+	atomic_val_t refs;
+
+	/* A receiver that is being unregistered can't be referenced */
+	do {
+		refs = atomic_get(&pEntry->refs);
+		if (refs & REFS_CLOSED) {
+			return NULL;
+		}
+	} while (!atomic_cas(&pEntry->refs, refs, refs + 1));
+
+	pMsgRxer = atomic_ptr_get(&pEntry->pMsgReceiver);
+	if (pMsgRxer == NULL) {
+		atomic_dec(&pEntry->refs);
+	}
+
+	return pMsgRxer;
+}
+
+static void ReleaseReceiver(FwkId_t RxId)
+{
+	atomic_dec(&msgTaskRegistry[RxId].refs);
+}
+
+/**
+ * @brief Remove a message from a queue.  Used by every receive path so
+ * that the liveness counters are updated.  A boosted message is still
+ * counted by its receiver.
+ */
+static BaseType_t ReceiveMsg(FwkQueue_t *pQueue, FwkMsg_t **ppMsg,
+			     TickType_t BlockTicks)
+{
+	BaseType_t status;
+
+	if (Framework_InterruptContext()) {
+		status = k_msgq_get(pQueue, ppMsg, K_NO_WAIT);
+	} else {
+		status = k_msgq_get(pQueue, ppMsg, BlockTicks);
+	}
+
+#ifdef CONFIG_FWK_LIVENESS
+	/* Receivers that don't dispatch (or use Framework_MsgReceiver) must
+	 * not appear to be stalled.
+	 */
+	if (status == 0 && *ppMsg != NULL) {
+		LivenessReceived(pQueue, (*ppMsg)->header.rxId);
+	}
+#endif
+
+	return status;
+}
+
+/* The receiver may have been removed from the registry */
+static size_t FlushQueue(FwkMsgReceiver_t *pMsgRxer)
+{
 	FwkMsg_t *pMsg;
 	size_t purged = 0;
+
 	while (true) {
 		pMsg = NULL;
-		k_msgq_get(msgTaskRegistry[RxId].pMsgReceiver->pQueue, &pMsg,
-			   K_NO_WAIT);
+		ReceiveMsg(pMsgRxer->pQueue, &pMsg, K_NO_WAIT);
 		if (pMsg != NULL) {
-			BufferPool_Free(pMsg);
+#ifdef CONFIG_FWK_MSG_PRIORITY
+			if (pMsg->header.options & FWK_MSG_OPTION_BOOSTED) {
+				Unboost(pMsgRxer);
+			}
+#endif
+			Framework_FreeMsg(pMsg);
 			purged += 1;
 		} else {
 			break;
@@ -400,21 +1001,274 @@ size_t Framework_Flush(FwkId_t RxId)
 	return purged;
 }
 
-/******************************************************************************/
-/* Local Function Definitions                                                 */
-/******************************************************************************/
+static BaseType_t QueueToReceiver(FwkMsgReceiver_t *pMsgRxer,
+				  FwkMsg_t *pMsg)
+{
+	BaseType_t result;
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	/* The message can't be accessed after it is queued */
+	bool boosted = Boost(pMsgRxer, pMsg);
+#endif
+#ifdef CONFIG_FWK_TRAFFIC
+	FwkId_t txId = pMsg->header.txId;
+	FwkMsgCode_t code = pMsg->header.msgCode;
+	size_t size = BufferPool_GetSize(pMsg);
+#endif
+
+	result = Framework_Queue(pMsgRxer->pQueue, &pMsg, K_NO_WAIT);
+
+#ifdef CONFIG_FWK_TRAFFIC
+	if (result == FWK_SUCCESS) {
+		FwkTraffic_Count(txId, pMsgRxer->id, code, size);
+	}
+#endif
+
+#ifdef CONFIG_FWK_MSG_PRIORITY
+	/* The message is returned to the caller */
+	if (boosted && result != FWK_SUCCESS) {
+		pMsg->header.options &= ~FWK_MSG_OPTION_BOOSTED;
+		Unboost(pMsgRxer);
+	}
+#endif
+
+#ifdef CONFIG_FWK_WORK_RECEIVER
+	/* Submitting work that is running makes it run again */
+	if (pMsgRxer->pWork != NULL && result == FWK_SUCCESS) {
+		k_work_submit_to_queue(&fwkWorkQ, pMsgRxer->pWork);
+	}
+#endif
+
+	return result;
+}
+
+#ifdef CONFIG_FWK_WORK_RECEIVER
 /**
- * @brief Initialize buffer pool (statistics).
+ * @brief Dispatch messages for a work receiver.  A work item doesn't run
+ * concurrently with itself, so a receiver's handlers are serialized.
  */
-static int Framework_Initialize(const struct device *device)
+static void WorkReceiverHandler(struct k_work *pWork)
 {
-	ARG_UNUSED(device);
+	FwkWorkReceiver_t *pWorkRxer =
+		CONTAINER_OF(pWork, FwkWorkReceiver_t, work);
+	FwkQueue_t *pQueue = pWorkRxer->rxer.pQueue;
+	FwkMsg_t *pMsg;
+	uint32_t i;
 
-	BufferPool_Initialize();
+	for (i = 0; i < CONFIG_FWK_WORK_BATCH; i++) {
+		pMsg = NULL;
+		ReceiveMsg(pQueue, &pMsg, K_NO_WAIT);
+		if (pMsg == NULL) {
+			return;
+		}
+		Framework_DispatchMsg(&pWorkRxer->rxer, pMsg);
+	}
 
-	return 0;
+	/* Let other receivers run before the rest of the messages */
+	if (k_msgq_num_used_get(pQueue) > 0) {
+		k_work_submit_to_queue(&fwkWorkQ, pWork);
+	}
+}
+#endif
+
+#ifdef CONFIG_FWK_MSG_PRIORITY
+/**
+ * @brief Raise the priority of the receiver thread.  The message is
+ * marked when it is counted so that exactly the counted messages are
+ * unboosted when they are dispatched, received, or flushed.  A receiver
+ * without a thread (tid not set yet) doesn't count the message.
+ *
+ * @retval true if the message was counted
+ */
+static bool Boost(FwkMsgReceiver_t *pMsgRxer, FwkMsg_t *pMsg)
+{
+	k_tid_t tid = atomic_ptr_get(&pMsgRxer->tid);
+	int priority;
+	bool raise;
+
+	/* A forwarded message may have been counted by another receiver */
+	pMsg->header.options &= ~FWK_MSG_OPTION_BOOSTED;
+
+	if (!(pMsg->header.options & FWK_MSG_OPTION_PRIORITY) || tid == NULL) {
+		return false;
+	}
+
+	pMsg->header.options |= FWK_MSG_OPTION_BOOSTED;
+
+	k_spinlock_key_t key = k_spin_lock(&priorityLock);
+	pMsgRxer->boosted += 1;
+	raise = (pMsg->header.priority < pMsgRxer->boostPriority);
+	if (raise) {
+		pMsgRxer->boostPriority = pMsg->header.priority;
+	}
+	priority = pMsgRxer->boostPriority;
+	k_spin_unlock(&priorityLock, key);
+
+	/* The scheduler can't be called with the lock held */
+	if (raise) {
+		k_thread_priority_set(tid, priority);
+	}
+
+	return true;
+}
+
+static void Unboost(FwkMsgReceiver_t *pMsgRxer)
+{
+	k_tid_t tid = atomic_ptr_get(&pMsgRxer->tid);
+	int priority;
+	bool restore;
+
+	if (tid == NULL) {
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&priorityLock);
+	if (pMsgRxer->boosted > 0) {
+		pMsgRxer->boosted -= 1;
+	}
+	restore = (pMsgRxer->boosted == 0 &&
+		   pMsgRxer->boostPriority != pMsgRxer->basePriority);
+	if (restore) {
+		pMsgRxer->boostPriority = pMsgRxer->basePriority;
+	}
+	k_spin_unlock(&priorityLock, key);
+
+	if (!restore) {
+		return;
+	}
+
+	k_thread_priority_set(tid, pMsgRxer->basePriority);
+
+	/* A sender may have raised the priority before it was restored */
+	key = k_spin_lock(&priorityLock);
+	priority = pMsgRxer->boostPriority;
+	k_spin_unlock(&priorityLock, key);
+
+	if (priority != pMsgRxer->basePriority) {
+		k_thread_priority_set(tid, priority);
+	}
+}
+
+/* A message removed with Framework_Receive isn't dispatched */
+static void UnboostReceived(FwkQueue_t *pQueue, FwkMsg_t *pMsg)
+{
+	FwkMsgReceiver_t *pMsgRxer;
+	FwkId_t id;
+
+	if (!(pMsg->header.options & FWK_MSG_OPTION_BOOSTED)) {
+		return;
+	}
+
+	pMsg->header.options &= ~FWK_MSG_OPTION_BOOSTED;
+
+	pMsgRxer = AcquireQueueOwner(pQueue, pMsg->header.rxId, &id);
+	if (pMsgRxer != NULL) {
+		Unboost(pMsgRxer);
+		ReleaseReceiver(id);
+	}
+}
+#endif
+
+#if CONFIG_FWK_UNICAST_CACHE_SIZE > 0
+static uint32_t RouteHash(FwkMsgCode_t Code)
+{
+	/* Fibonacci hashing spreads consecutive codes */
+	return ((uint32_t)Code * 0x9E3779B1U) >> 16;
 }
 
+/**
+ * @brief Send a unicast message using the cached route for its code.
+ * The route is only used after the dispatcher of the receiver is checked,
+ * so a stale entry (receiver unregistered or replaced) is removed rather
+ * than used.
+ *
+ * @retval true if a route was found and pResult contains the queue status
+ */
+static bool RouteLookup(FwkMsg_t *pMsg, BaseType_t *pResult)
+{
+	FwkMsgCode_t code = pMsg->header.msgCode;
+	uint32_t hash = RouteHash(code);
+	FwkMsgReceiver_t *pMsgRxer;
+	atomic_t *pSlot;
+	atomic_val_t route;
+	FwkId_t id;
+	uint32_t i;
+
+	for (i = 0; i < ROUTE_CACHE_PROBES; i++) {
+		pSlot = &routeCache[(hash + i) & ROUTE_CACHE_MASK];
+		route = atomic_get(pSlot);
+		if (route == 0) {
+			return false;
+		}
+		if (ROUTE_CODE(route) != code) {
+			continue;
+		}
+
+		id = ROUTE_ID(route);
+		pMsgRxer = (id < MAX_MSG_RECEIVERS) ? AcquireReceiver(id) :
+						      NULL;
+		if (pMsgRxer != NULL) {
+			if (pMsgRxer->pMsgDispatcher != NULL &&
+			    pMsgRxer->pMsgDispatcher(code) != NULL) {
+				pMsg->header.rxId = id;
+				*pResult = QueueToReceiver(pMsgRxer, pMsg);
+				ReleaseReceiver(id);
+				return true;
+			}
+			ReleaseReceiver(id);
+		}
+
+		atomic_cas(pSlot, route, 0);
+		return false;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Cache the receiver found by a search that started at Generation.
+ * If a receiver was registered (or unregistered) during the search, then
+ * the route can be stale.  The cache may have been invalidated before the
+ * insert, so the route is removed again.
+ */
+static void RouteInsert(FwkMsgCode_t Code, FwkId_t RxId,
+			atomic_val_t Generation)
+{
+	atomic_val_t route = ROUTE_PACK(Code, RxId);
+	uint32_t hash = RouteHash(Code);
+	atomic_t *pSlot = NULL;
+	uint32_t i;
+
+	for (i = 0; i < ROUTE_CACHE_PROBES; i++) {
+		pSlot = &routeCache[(hash + i) & ROUTE_CACHE_MASK];
+		if (atomic_cas(pSlot, 0, route) ||
+		    atomic_get(pSlot) == route) {
+			break;
+		}
+	}
+
+	/* Probe window is full, replace the first entry */
+	if (i == ROUTE_CACHE_PROBES) {
+		pSlot = &routeCache[hash & ROUTE_CACHE_MASK];
+		atomic_set(pSlot, route);
+	}
+
+	if (atomic_get(&routeGeneration) != Generation) {
+		atomic_cas(pSlot, route, 0);
+	}
+}
+
+/* Called after the registry changes */
+static void RouteInvalidate(void)
+{
+	uint32_t i;
+
+	atomic_inc(&routeGeneration);
+	for (i = 0; i < CONFIG_FWK_UNICAST_CACHE_SIZE; i++) {
+		atomic_set(&routeCache[i], 0);
+	}
+}
+#endif
+
 /******************************************************************************/
 /* Interrupt Service Routines                                                 */
 /******************************************************************************/
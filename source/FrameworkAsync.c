@@ -0,0 +1,344 @@
+/**
+ * @file FrameworkAsync.c
+ * @brief Requests that resume a continuation when the reply arrives.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "FrameworkOs.h"
+LOG_MODULE_REGISTER(fwk_async, CONFIG_FRAMEWORK_LOG_LEVEL);
+
+#define FWK_FNAME "FrameworkAsync"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "BufferPool.h"
+#include "Framework.h"
+#include "FrameworkAsync.h"
+
+#ifdef CONFIG_FWK_AUTO_GENERATE_FILES
+#include <framework_msgcodes.h>
+#endif
+
+#ifndef CONFIG_FWK_POSIX
+#if __has_include(<zephyr/version.h>)
+#include <zephyr/version.h>
+#else
+#include <version.h>
+#endif
+#endif
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+/* Before Zephyr 3.4 there aren't timepoints */
+#if !defined(CONFIG_FWK_POSIX) && (KERNEL_VERSION_NUMBER < 0x030400)
+typedef struct {
+	int64_t tick;
+} k_timepoint_t;
+
+static k_timepoint_t sys_timepoint_calc(k_timeout_t timeout);
+static bool sys_timepoint_expired(k_timepoint_t timepoint);
+#endif
+
+typedef struct PendingRequest {
+	uint32_t correlationId; /** 0 when the entry is free */
+	FwkId_t rxerId;
+	FwkContinuation_t continuation;
+	void *pFrame;
+	k_timepoint_t deadline;
+	struct k_timer timer;
+} PendingRequest_t;
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static bool TakePending(FwkId_t RxerId, uint32_t CorrelationId,
+			PendingRequest_t *pRequest);
+static bool TakeExpired(FwkId_t RxerId, PendingRequest_t *pRequest);
+static void RemovePending(PendingRequest_t *pEntry);
+static void TimeoutHandler(struct k_timer *pTimer);
+static int FwkAsync_Initialize(const struct device *device);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static PendingRequest_t pendingTable[CONFIG_FWK_ASYNC_MAX_PENDING];
+
+static struct k_spinlock pendingLock;
+
+static atomic_t pendingCount;
+
+static atomic_t nextCorrelationId;
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+SYS_INIT(FwkAsync_Initialize, POST_KERNEL, 0);
+
+int FwkAsync_Request(FwkMsgReceiver_t *pRxer, FwkId_t RxId,
+		     FwkAsyncMsg_t *pRequest, FwkContinuation_t Continuation,
+		     void *pFrame, k_timeout_t Timeout)
+{
+	PendingRequest_t *pEntry = NULL;
+	k_timepoint_t deadline;
+	uint32_t id;
+	size_t i;
+
+	if (pRxer == NULL || pRequest == NULL || Continuation == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+
+	/* Zero is used for free entries */
+	do {
+		id = (uint32_t)atomic_inc(&nextCorrelationId) + 1;
+	} while (id == 0);
+
+	/* The timeout can be relative or absolute */
+	deadline = sys_timepoint_calc(Timeout);
+
+	k_spinlock_key_t key = k_spin_lock(&pendingLock);
+	for (i = 0; i < CONFIG_FWK_ASYNC_MAX_PENDING; i++) {
+		if (pendingTable[i].correlationId == 0) {
+			pEntry = &pendingTable[i];
+			pEntry->correlationId = id;
+			pEntry->rxerId = pRxer->id;
+			pEntry->continuation = Continuation;
+			pEntry->pFrame = pFrame;
+			pEntry->deadline = deadline;
+			/* The reply can't arrive before the request is sent */
+			if (!K_TIMEOUT_EQ(Timeout, K_FOREVER)) {
+				k_timer_start(&pEntry->timer, Timeout,
+					      K_NO_WAIT);
+			}
+			atomic_inc(&pendingCount);
+			break;
+		}
+	}
+	k_spin_unlock(&pendingLock, key);
+
+	if (pEntry == NULL) {
+		LOG_ERR("Too many pending requests");
+		Framework_FreeMsg((FwkMsg_t *)pRequest);
+		return -ENOMEM;
+	}
+
+	pRequest->header.txId = pRxer->id;
+	pRequest->correlationId = id;
+	if (Framework_Send(RxId, (FwkMsg_t *)pRequest) != FWK_SUCCESS) {
+		TakePending(pRxer->id, id, NULL);
+		Framework_FreeMsg((FwkMsg_t *)pRequest);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+BaseType_t FwkAsync_Reply(const FwkAsyncMsg_t *pRequest,
+			  FwkAsyncMsg_t *pReply)
+{
+	BaseType_t result;
+
+	if (pRequest == NULL || pReply == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return FWK_ERROR;
+	}
+
+	pReply->header.txId = pRequest->header.rxId;
+	pReply->header.options |= FWK_MSG_OPTION_ASYNC;
+	pReply->correlationId = pRequest->correlationId;
+
+	result = Framework_Send(pRequest->header.txId, (FwkMsg_t *)pReply);
+	if (result != FWK_SUCCESS) {
+		Framework_FreeMsg((FwkMsg_t *)pReply);
+	}
+
+	return result;
+}
+
+bool FwkAsync_Resume(FwkMsgReceiver_t *pRxer, FwkMsg_t *pMsg,
+		     DispatchResult_t *pResult)
+{
+	PendingRequest_t request;
+	uint32_t id;
+
+	if (!(pMsg->header.options & FWK_MSG_OPTION_ASYNC) ||
+	    BufferPool_GetSize(pMsg) < sizeof(FwkAsyncMsg_t)) {
+		return false;
+	}
+
+	/* Sent by a request timer so that FwkAsync_Expire runs */
+	id = ((FwkAsyncMsg_t *)pMsg)->correlationId;
+	if (id == 0) {
+		*pResult = DISPATCH_OK;
+		return true;
+	}
+
+	/* A late reply is given to the handler for its message code */
+	if (!TakePending(pRxer->id, id, &request)) {
+		return false;
+	}
+
+	*pResult = request.continuation(pRxer, pMsg, request.pFrame);
+
+	return true;
+}
+
+void FwkAsync_Expire(FwkMsgReceiver_t *pRxer)
+{
+	PendingRequest_t request;
+
+	if (atomic_get(&pendingCount) == 0) {
+		return;
+	}
+
+	while (TakeExpired(pRxer->id, &request)) {
+		request.continuation(pRxer, NULL, request.pFrame);
+	}
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int FwkAsync_Initialize(const struct device *device)
+{
+	size_t i;
+
+	ARG_UNUSED(device);
+
+	for (i = 0; i < CONFIG_FWK_ASYNC_MAX_PENDING; i++) {
+		k_timer_init(&pendingTable[i].timer, TimeoutHandler, NULL);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Remove a pending request (and copy it when pRequest isn't NULL).
+ */
+static bool TakePending(FwkId_t RxerId, uint32_t CorrelationId,
+			PendingRequest_t *pRequest)
+{
+	bool found = false;
+	size_t i;
+
+	if (CorrelationId == 0) {
+		return false;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&pendingLock);
+	for (i = 0; i < CONFIG_FWK_ASYNC_MAX_PENDING; i++) {
+		if (pendingTable[i].correlationId == CorrelationId &&
+		    pendingTable[i].rxerId == RxerId) {
+			if (pRequest != NULL) {
+				*pRequest = pendingTable[i];
+			}
+			RemovePending(&pendingTable[i]);
+			found = true;
+			break;
+		}
+	}
+	k_spin_unlock(&pendingLock, key);
+
+	return found;
+}
+
+static bool TakeExpired(FwkId_t RxerId, PendingRequest_t *pRequest)
+{
+	bool found = false;
+	size_t i;
+
+	k_spinlock_key_t key = k_spin_lock(&pendingLock);
+	for (i = 0; i < CONFIG_FWK_ASYNC_MAX_PENDING; i++) {
+		if (pendingTable[i].correlationId != 0 &&
+		    pendingTable[i].rxerId == RxerId &&
+		    sys_timepoint_expired(pendingTable[i].deadline)) {
+			*pRequest = pendingTable[i];
+			RemovePending(&pendingTable[i]);
+			found = true;
+			break;
+		}
+	}
+	k_spin_unlock(&pendingLock, key);
+
+	return found;
+}
+
+/* Called with the lock held */
+static void RemovePending(PendingRequest_t *pEntry)
+{
+	k_timer_stop(&pEntry->timer);
+	pEntry->correlationId = 0;
+	atomic_dec(&pendingCount);
+}
+
+/**
+ * @brief Wake the receiver that made the request so that it expires the
+ * request (a receiver that isn't sent any other messages would wait
+ * forever).  The continuation is called in the context of the receiver.
+ */
+static void TimeoutHandler(struct k_timer *pTimer)
+{
+	PendingRequest_t *pEntry =
+		CONTAINER_OF(pTimer, PendingRequest_t, timer);
+	FwkId_t rxerId = FWK_ID_RESERVED;
+	FwkAsyncMsg_t *pWake;
+
+	k_spinlock_key_t key = k_spin_lock(&pendingLock);
+	if (pEntry->correlationId != 0) {
+		rxerId = pEntry->rxerId;
+	}
+	k_spin_unlock(&pendingLock, key);
+
+	if (rxerId == FWK_ID_RESERVED) {
+		return;
+	}
+
+	pWake = BP_TRY_TO_TAKE(sizeof(FwkAsyncMsg_t));
+	if (pWake == NULL) {
+		/* Expired by the next message that is dispatched */
+		LOG_WRN("Unable to wake receiver %u", rxerId);
+		return;
+	}
+
+	/* The code must be valid but the message isn't given to a handler */
+	pWake->header.msgCode = FMC_PERIODIC;
+	pWake->header.rxId = rxerId;
+	pWake->header.txId = rxerId;
+	pWake->header.options = FWK_MSG_OPTION_ASYNC;
+	pWake->correlationId = 0;
+	if (Framework_Send(rxerId, (FwkMsg_t *)pWake) != FWK_SUCCESS) {
+		Framework_FreeMsg((FwkMsg_t *)pWake);
+	}
+}
+
+#if !defined(CONFIG_FWK_POSIX) && (KERNEL_VERSION_NUMBER < 0x030400)
+static k_timepoint_t sys_timepoint_calc(k_timeout_t timeout)
+{
+	k_timepoint_t timepoint;
+
+	if (K_TIMEOUT_EQ(timeout, K_FOREVER)) {
+		timepoint.tick = INT64_MAX;
+		return timepoint;
+	}
+
+#ifdef CONFIG_TIMEOUT_64BIT
+	if (Z_TICK_ABS(timeout.ticks) >= 0) {
+		timepoint.tick = Z_TICK_ABS(timeout.ticks);
+		return timepoint;
+	}
+#endif
+
+	timepoint.tick = k_uptime_ticks() + MAX(timeout.ticks, 0);
+	return timepoint;
+}
+
+static bool sys_timepoint_expired(k_timepoint_t timepoint)
+{
+	return timepoint.tick != INT64_MAX &&
+	       timepoint.tick <= k_uptime_ticks();
+}
+#endif
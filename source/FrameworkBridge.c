@@ -0,0 +1,669 @@
+/**
+ * @file FrameworkBridge.c
+ * @brief Serializes routed messages into frames for another processor and
+ * injects messages from received frames.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(fwk_bridge, CONFIG_FRAMEWORK_LOG_LEVEL);
+
+#define FWK_FNAME "FrameworkBridge"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr/init.h>
+#include <zephyr/sys/crc.h>
+#include <string.h>
+
+#include "BufferPool.h"
+#include "Framework.h"
+#include "FrameworkMsg.h"
+#include "FrameworkBridge.h"
+
+#include <framework_ids.h>
+#include <framework_msgcodes.h>
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define FRAME_SOF 0xA5
+#define FRAME_SIZE CONFIG_FWK_BRIDGE_FRAME_SIZE
+#define CRC_SEED 0xFFFF
+#define CRC_SIZE 2
+
+/* A 32-bit value requires at most 5 bytes */
+#define VARINT_MAX 5
+
+#define FRAME_HEADER_MAX (1 + VARINT_MAX)
+
+/* kind, code, rx ID, and length */
+#define RECORD_HEADER_MAX (1 + (3 * VARINT_MAX))
+
+/* The sequence is odd while the entry is changed (routes are read without
+ * a lock by the dispatcher).
+ */
+typedef struct RouteEntry {
+	FwkBridgeRoute_t route;
+	bool inUse;
+	atomic_t seq;
+} RouteEntry_t;
+
+/* Payload size of a raw message that can be received */
+typedef struct RawType {
+	FwkMsgCode_t msgCode;
+	uint16_t rawSize;
+	bool inUse;
+} RawType_t;
+
+typedef enum RxStateEnum {
+	RX_STATE_SOF = 0,
+	RX_STATE_LENGTH,
+	RX_STATE_BODY,
+} RxState_t;
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int FwkBridge_Initialize(const struct device *device);
+static void FwkBridgeThread(void *pArg1, void *pArg2, void *pArg3);
+static FwkMsgHandler_t *BridgeDispatcher(FwkMsgCode_t MsgCode);
+static DispatchResult_t BridgeMsgHandler(FwkMsgReceiver_t *pMsgRxer,
+					 FwkMsg_t *pMsg);
+static bool AcceptBroadcast(const FwkMsg_t *pMsg);
+static void Encode(const FwkBridgeRoute_t *pRoute, const FwkMsg_t *pMsg);
+static void Flush(void);
+static void ProcessFrame(void);
+static bool ParseRecord(size_t *pOffset);
+static void Inject(uint8_t Kind, uint32_t Code, uint32_t RxId,
+		   const uint8_t *pPayload, size_t Length);
+static size_t PutVarint(uint8_t *pDest, uint32_t Value);
+static bool GetVarint(const uint8_t *pSrc, size_t Length, size_t *pOffset,
+		      uint32_t *pValue);
+static bool GetRoute(FwkMsgCode_t MsgCode, FwkBridgeRoute_t *pRoute);
+static RouteEntry_t *FindEntry(FwkMsgCode_t MsgCode);
+static void SetEntry(RouteEntry_t *pEntry, const FwkBridgeRoute_t *pRoute);
+static bool RawSizeValid(uint32_t Code, size_t Length);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static FwkMsgTask_t bridgeTask;
+
+K_THREAD_STACK_DEFINE(bridgeStack, CONFIG_FWK_BRIDGE_STACK_SIZE);
+
+K_MSGQ_DEFINE(bridgeQueue, FWK_QUEUE_ENTRY_SIZE, CONFIG_FWK_BRIDGE_QUEUE_DEPTH,
+	      FWK_QUEUE_ALIGNMENT);
+
+static RouteEntry_t routes[CONFIG_FWK_BRIDGE_MAX_ROUTES];
+
+static RawType_t rawTypes[CONFIG_FWK_BRIDGE_MAX_ROUTES];
+
+/* Serializes route changes and protects the transport and raw types */
+static struct k_spinlock bridgeLock;
+
+static FwkBridgeTransport_t transport;
+static void *transportContext;
+
+/* Records are placed after the space reserved for the frame header.
+ * Only accessed by the bridge thread.
+ */
+static uint8_t txFrame[FRAME_HEADER_MAX + FRAME_SIZE + CRC_SIZE];
+static size_t txLength;
+
+/* Only accessed by the transport receive context */
+static struct {
+	RxState_t state;
+	uint32_t length;
+	uint8_t shift;
+	size_t count;
+	uint8_t frame[FRAME_SIZE + CRC_SIZE];
+} rx;
+
+static FwkBridgeStats_t bridgeStats;
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+SYS_INIT(FwkBridge_Initialize, APPLICATION,
+	 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+void FwkBridge_SetTransport(FwkBridgeTransport_t Transport, void *pContext)
+{
+	k_spinlock_key_t key = k_spin_lock(&bridgeLock);
+
+	transport = Transport;
+	transportContext = pContext;
+
+	k_spin_unlock(&bridgeLock, key);
+}
+
+int FwkBridge_AddRoute(const FwkBridgeRoute_t *pRoute)
+{
+	RouteEntry_t *pEntry;
+	size_t i;
+
+	if (pRoute == NULL || pRoute->msgCode == FMC_INVALID) {
+		return -EINVAL;
+	}
+	if (pRoute->kind > FWK_BRIDGE_KIND_BUFFER) {
+		return -EINVAL;
+	}
+	/* Raw payloads are sent in the byte order of the processor */
+	if (pRoute->kind == FWK_BRIDGE_KIND_RAW &&
+	    IS_ENABLED(CONFIG_BIG_ENDIAN)) {
+		return -ENOTSUP;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&bridgeLock);
+
+	pEntry = FindEntry(pRoute->msgCode);
+	for (i = 0; pEntry == NULL && i < ARRAY_SIZE(routes); i++) {
+		if (!routes[i].inUse) {
+			pEntry = &routes[i];
+		}
+	}
+	if (pEntry != NULL) {
+		SetEntry(pEntry, pRoute);
+	}
+
+	k_spin_unlock(&bridgeLock, key);
+
+	return (pEntry != NULL) ? 0 : -ENOMEM;
+}
+
+int FwkBridge_RemoveRoute(FwkMsgCode_t msgCode)
+{
+	k_spinlock_key_t key = k_spin_lock(&bridgeLock);
+
+	RouteEntry_t *pEntry = FindEntry(msgCode);
+	if (pEntry != NULL) {
+		SetEntry(pEntry, NULL);
+	}
+
+	k_spin_unlock(&bridgeLock, key);
+
+	return (pEntry != NULL) ? 0 : -ENOENT;
+}
+
+int FwkBridge_AddRawType(FwkMsgCode_t msgCode, uint16_t rawSize)
+{
+	RawType_t *pType = NULL;
+	size_t i;
+
+	if (msgCode == FMC_INVALID) {
+		return -EINVAL;
+	}
+	if (IS_ENABLED(CONFIG_BIG_ENDIAN)) {
+		return -ENOTSUP;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&bridgeLock);
+
+	for (i = 0; i < ARRAY_SIZE(rawTypes); i++) {
+		if (rawTypes[i].inUse && rawTypes[i].msgCode == msgCode) {
+			pType = &rawTypes[i];
+			break;
+		}
+		if (!rawTypes[i].inUse && pType == NULL) {
+			pType = &rawTypes[i];
+		}
+	}
+	if (pType != NULL) {
+		pType->msgCode = msgCode;
+		pType->rawSize = rawSize;
+		pType->inUse = true;
+	}
+
+	k_spin_unlock(&bridgeLock, key);
+
+	return (pType != NULL) ? 0 : -ENOMEM;
+}
+
+void FwkBridge_RxBytes(const uint8_t *pData, size_t Length)
+{
+	uint8_t b;
+	size_t i;
+
+	if (pData == NULL && Length > 0) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	for (i = 0; i < Length; i++) {
+		b = pData[i];
+		switch (rx.state) {
+		case RX_STATE_SOF:
+			if (b == FRAME_SOF) {
+				rx.length = 0;
+				rx.shift = 0;
+				rx.state = RX_STATE_LENGTH;
+			}
+			break;
+
+		case RX_STATE_LENGTH:
+			rx.length |= (uint32_t)(b & 0x7F) << rx.shift;
+			rx.shift += 7;
+			if ((b & 0x80) != 0) {
+				if (rx.shift >= (7 * VARINT_MAX)) {
+					bridgeStats.framesDropped += 1;
+					rx.state = RX_STATE_SOF;
+				}
+			} else if (rx.length == 0 || rx.length > FRAME_SIZE) {
+				bridgeStats.framesDropped += 1;
+				rx.state = RX_STATE_SOF;
+			} else {
+				rx.count = 0;
+				rx.state = RX_STATE_BODY;
+			}
+			break;
+
+		case RX_STATE_BODY:
+			rx.frame[rx.count++] = b;
+			if (rx.count == (rx.length + CRC_SIZE)) {
+				ProcessFrame();
+				rx.state = RX_STATE_SOF;
+			}
+			break;
+
+		default:
+			rx.state = RX_STATE_SOF;
+			break;
+		}
+	}
+}
+
+void FwkBridge_GetStats(FwkBridgeStats_t *pStats)
+{
+	if (pStats == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	*pStats = bridgeStats;
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int FwkBridge_Initialize(const struct device *device)
+{
+	ARG_UNUSED(device);
+
+	bridgeTask.rxer.id = FWK_ID_BRIDGE;
+	bridgeTask.rxer.pQueue = &bridgeQueue;
+	bridgeTask.rxer.rxBlockTicks = K_FOREVER;
+	bridgeTask.rxer.pMsgDispatcher = BridgeDispatcher;
+	bridgeTask.rxer.acceptBroadcast = AcceptBroadcast;
+
+	Framework_RegisterTask(&bridgeTask);
+
+	bridgeTask.pTid = k_thread_create(
+		&bridgeTask.threadData, bridgeStack,
+		K_THREAD_STACK_SIZEOF(bridgeStack), FwkBridgeThread,
+		&bridgeTask, NULL, NULL, CONFIG_FWK_BRIDGE_PRIORITY, 0,
+		K_NO_WAIT);
+
+	k_thread_name_set(bridgeTask.pTid, "fwk_bridge");
+
+	return 0;
+}
+
+static void FwkBridgeThread(void *pArg1, void *pArg2, void *pArg3)
+{
+	FwkMsgTask_t *pMsgTask = (FwkMsgTask_t *)pArg1;
+
+	ARG_UNUSED(pArg2);
+	ARG_UNUSED(pArg3);
+
+	while (true) {
+		Framework_MsgReceiver(&pMsgTask->rxer);
+
+		/* Messages that are already queued go in the same frame */
+		if (k_msgq_num_used_get(pMsgTask->rxer.pQueue) == 0) {
+			Flush();
+		}
+	}
+}
+
+/* Any message code with a route is handled by the bridge */
+static FwkMsgHandler_t *BridgeDispatcher(FwkMsgCode_t MsgCode)
+{
+	FwkBridgeRoute_t route;
+
+	return GetRoute(MsgCode, &route) ? BridgeMsgHandler : NULL;
+}
+
+static DispatchResult_t BridgeMsgHandler(FwkMsgReceiver_t *pMsgRxer,
+					 FwkMsg_t *pMsg)
+{
+	FwkBridgeRoute_t route;
+
+	ARG_UNUSED(pMsgRxer);
+
+	/* Pointers aren't valid on the other side */
+	if ((pMsg->header.options & FWK_MSG_OPTION_LOCAL_ONLY) ||
+	    !GetRoute(pMsg->header.msgCode, &route)) {
+		bridgeStats.msgsDropped += 1;
+	} else {
+		Encode(&route, pMsg);
+	}
+
+	return DISPATCH_OK;
+}
+
+/* Don't send broadcasts that came from the other side back */
+static bool AcceptBroadcast(const FwkMsg_t *pMsg)
+{
+	return (pMsg->header.txId != FWK_ID_BRIDGE);
+}
+
+static void Encode(const FwkBridgeRoute_t *pRoute, const FwkMsg_t *pMsg)
+{
+	uint8_t record[RECORD_HEADER_MAX];
+	const FwkBufMsg_t *pBufMsg;
+	const uint8_t *pPayload;
+	size_t size = BufferPool_GetSize(pMsg);
+	size_t length;
+	size_t n = 0;
+
+	if (pRoute->kind == FWK_BRIDGE_KIND_BUFFER) {
+		pBufMsg = (const FwkBufMsg_t *)pMsg;
+		if (size < sizeof(FwkBufMsg_t) ||
+		    pBufMsg->length > FWK_BUF_MSG_BUFFER_SIZE(pBufMsg)) {
+			bridgeStats.msgsDropped += 1;
+			return;
+		}
+		pPayload = pBufMsg->buffer;
+		length = pBufMsg->length;
+	} else {
+		/* The buffer can be larger than the type that was taken */
+		if (size < (sizeof(FwkMsgHeader_t) + pRoute->rawSize)) {
+			bridgeStats.msgsDropped += 1;
+			return;
+		}
+		pPayload = (const uint8_t *)pMsg + sizeof(FwkMsgHeader_t);
+		length = pRoute->rawSize;
+	}
+
+	record[n++] = pRoute->kind;
+	n += PutVarint(&record[n], pMsg->header.msgCode);
+	n += PutVarint(&record[n], pRoute->remoteRxId);
+	n += PutVarint(&record[n], length);
+
+	if ((n + length) > FRAME_SIZE) {
+		LOG_WRN("Message code %u too large for frame (%zu)",
+			pMsg->header.msgCode, n + length);
+		bridgeStats.msgsDropped += 1;
+		return;
+	}
+
+	if ((txLength + n + length) > FRAME_SIZE) {
+		Flush();
+	}
+
+	memcpy(&txFrame[FRAME_HEADER_MAX + txLength], record, n);
+	txLength += n;
+	memcpy(&txFrame[FRAME_HEADER_MAX + txLength], pPayload, length);
+	txLength += length;
+	bridgeStats.msgsSent += 1;
+}
+
+static void Flush(void)
+{
+	uint8_t header[FRAME_HEADER_MAX];
+	FwkBridgeTransport_t send;
+	void *pContext;
+	size_t headerLength;
+	size_t start;
+	uint16_t crc;
+
+	if (txLength == 0) {
+		return;
+	}
+
+	crc = crc16_ccitt(CRC_SEED, &txFrame[FRAME_HEADER_MAX], txLength);
+	txFrame[FRAME_HEADER_MAX + txLength] = (uint8_t)crc;
+	txFrame[FRAME_HEADER_MAX + txLength + 1] = (uint8_t)(crc >> 8);
+
+	/* The header is placed immediately before the records */
+	header[0] = FRAME_SOF;
+	headerLength = 1 + PutVarint(&header[1], txLength);
+	start = FRAME_HEADER_MAX - headerLength;
+	memcpy(&txFrame[start], header, headerLength);
+
+	k_spinlock_key_t key = k_spin_lock(&bridgeLock);
+	send = transport;
+	pContext = transportContext;
+	k_spin_unlock(&bridgeLock, key);
+
+	if (send != NULL &&
+	    send(&txFrame[start], headerLength + txLength + CRC_SIZE,
+		 pContext) == 0) {
+		bridgeStats.framesSent += 1;
+	} else {
+		bridgeStats.sendErrors += 1;
+	}
+
+	txLength = 0;
+}
+
+static void ProcessFrame(void)
+{
+	uint16_t crc = crc16_ccitt(CRC_SEED, rx.frame, rx.length);
+	uint16_t expected = rx.frame[rx.length] |
+			    ((uint16_t)rx.frame[rx.length + 1] << 8);
+	size_t offset = 0;
+
+	if (crc != expected) {
+		bridgeStats.framesDropped += 1;
+		return;
+	}
+
+	bridgeStats.framesReceived += 1;
+	while (offset < rx.length) {
+		if (!ParseRecord(&offset)) {
+			/* The rest of the frame can't be trusted */
+			bridgeStats.injectErrors += 1;
+			break;
+		}
+	}
+}
+
+static bool ParseRecord(size_t *pOffset)
+{
+	uint32_t code;
+	uint32_t rxId;
+	uint32_t length;
+	uint8_t kind = rx.frame[(*pOffset)++];
+
+	if (!GetVarint(rx.frame, rx.length, pOffset, &code) ||
+	    !GetVarint(rx.frame, rx.length, pOffset, &rxId) ||
+	    !GetVarint(rx.frame, rx.length, pOffset, &length)) {
+		return false;
+	}
+	if (length > (rx.length - *pOffset)) {
+		return false;
+	}
+
+	Inject(kind, code, rxId, &rx.frame[*pOffset], length);
+	*pOffset += length;
+
+	return true;
+}
+
+static void Inject(uint8_t Kind, uint32_t Code, uint32_t RxId,
+		   const uint8_t *pPayload, size_t Length)
+{
+	FwkBufMsg_t *pBufMsg;
+	FwkMsg_t *pMsg;
+	BaseType_t result;
+	size_t size;
+
+	if (Code == FMC_INVALID || Code > FWK_MSG_CODE_MAX ||
+	    RxId >= __FRAMEWORK_MAX_MSG_RECEIVERS || RxId == FWK_ID_BRIDGE ||
+	    Kind > FWK_BRIDGE_KIND_BUFFER) {
+		bridgeStats.injectErrors += 1;
+		return;
+	}
+
+	if (Kind == FWK_BRIDGE_KIND_BUFFER) {
+		size = FWK_BUFFER_MSG_SIZE(FwkBufMsg_t, Length);
+		pBufMsg = BP_TRY_TO_TAKE(size);
+		if (pBufMsg != NULL) {
+#ifndef CONFIG_FWK_COMPACT_MSG
+			pBufMsg->size = Length;
+#endif
+			pBufMsg->length = Length;
+			memcpy(pBufMsg->buffer, pPayload, Length);
+		}
+		pMsg = (FwkMsg_t *)pBufMsg;
+	} else {
+		/* The layout on the other side may not match the local type */
+		if (!RawSizeValid(Code, Length)) {
+			LOG_WRN("Raw message code %u has unexpected size %zu",
+				Code, Length);
+			bridgeStats.injectErrors += 1;
+			return;
+		}
+		size = sizeof(FwkMsgHeader_t) + Length;
+		pMsg = BP_TRY_TO_TAKE(size);
+		if (pMsg != NULL) {
+			memcpy((uint8_t *)pMsg + sizeof(FwkMsgHeader_t),
+			       pPayload, Length);
+		}
+	}
+
+	if (pMsg == NULL) {
+		bridgeStats.injectErrors += 1;
+		return;
+	}
+
+	/* Replies are sent back over the bridge */
+	FRAMEWORK_MSG_HEADER_INIT(pMsg, Code, FWK_ID_BRIDGE);
+
+	if (RxId == FWK_ID_RESERVED) {
+		result = Framework_Broadcast(pMsg, size);
+	} else {
+		result = Framework_Send(RxId, pMsg);
+	}
+
+	if (result == FWK_SUCCESS) {
+		bridgeStats.msgsInjected += 1;
+	} else {
+		Framework_FreeMsg(pMsg);
+		bridgeStats.injectErrors += 1;
+	}
+}
+
+/* Unsigned LEB128 */
+static size_t PutVarint(uint8_t *pDest, uint32_t Value)
+{
+	size_t n = 0;
+
+	while (Value >= 0x80) {
+		pDest[n++] = (uint8_t)(Value | 0x80);
+		Value >>= 7;
+	}
+	pDest[n++] = (uint8_t)Value;
+
+	return n;
+}
+
+static bool GetVarint(const uint8_t *pSrc, size_t Length, size_t *pOffset,
+		      uint32_t *pValue)
+{
+	uint32_t value = 0;
+	uint8_t shift = 0;
+	uint8_t b;
+
+	do {
+		if (*pOffset >= Length || shift >= (7 * VARINT_MAX)) {
+			return false;
+		}
+		b = pSrc[(*pOffset)++];
+		value |= (uint32_t)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+
+	*pValue = value;
+	return true;
+}
+
+/**
+ * @brief Called for every message that is dispatched to the bridge (and
+ * for every unicast and broadcast), so it doesn't lock.  An entry is read
+ * again if it was changed while it was copied.
+ */
+static bool GetRoute(FwkMsgCode_t MsgCode, FwkBridgeRoute_t *pRoute)
+{
+	RouteEntry_t *pEntry;
+	atomic_val_t seq;
+	bool found;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		pEntry = &routes[i];
+		do {
+			seq = atomic_get(&pEntry->seq);
+			found = pEntry->inUse &&
+				pEntry->route.msgCode == MsgCode;
+			if (found) {
+				*pRoute = pEntry->route;
+			}
+		} while ((seq & 1) != 0 || atomic_get(&pEntry->seq) != seq);
+
+		if (found) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Called with the lock held (a NULL route frees the entry) */
+static void SetEntry(RouteEntry_t *pEntry, const FwkBridgeRoute_t *pRoute)
+{
+	atomic_inc(&pEntry->seq);
+	if (pRoute != NULL) {
+		pEntry->route = *pRoute;
+	}
+	pEntry->inUse = (pRoute != NULL);
+	atomic_inc(&pEntry->seq);
+}
+
+/* Called with the lock held */
+static RouteEntry_t *FindEntry(FwkMsgCode_t MsgCode)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		if (routes[i].inUse && routes[i].route.msgCode == MsgCode) {
+			return &routes[i];
+		}
+	}
+
+	return NULL;
+}
+
+static bool RawSizeValid(uint32_t Code, size_t Length)
+{
+	bool valid = false;
+	size_t i;
+
+	k_spinlock_key_t key = k_spin_lock(&bridgeLock);
+
+	for (i = 0; i < ARRAY_SIZE(rawTypes); i++) {
+		if (rawTypes[i].inUse && rawTypes[i].msgCode == Code) {
+			valid = (rawTypes[i].rawSize == Length);
+			break;
+		}
+	}
+
+	k_spin_unlock(&bridgeLock, key);
+
+	return valid;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file FrameworkLiveness.c
+ * @brief Detects receivers that are stalled or slow without sending
+ * messages.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(fwk_liveness, CONFIG_FRAMEWORK_LOG_LEVEL);
+
+#define FWK_FNAME "FrameworkLiveness"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr/init.h>
+
+#ifdef CONFIG_FWK_LIVENESS_TASK_WDT
+#include <zephyr/task_wdt/task_wdt.h>
+#endif
+
+#include "Framework.h"
+#include "FrameworkLiveness.h"
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int FwkLiveness_Initialize(const struct device *device);
+static void MonitorHandler(struct k_work *pWork);
+static void CheckReceiver(FwkMsgReceiver_t *pRxer, void *pContext);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static K_WORK_DELAYABLE_DEFINE(monitorWork, MonitorHandler);
+
+static atomic_t healthy = ATOMIC_INIT(1);
+
+#ifdef CONFIG_FWK_LIVENESS_TASK_WDT
+static int wdtChannel = -1;
+#endif
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+SYS_INIT(FwkLiveness_Initialize, APPLICATION,
+	 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT);
+
+__weak void FwkLiveness_StallHandler(FwkMsgReceiver_t *pRxer, uint32_t WaitMs)
+{
+	LOG_ERR("Receiver %u stalled for %u ms", pRxer->id, WaitMs);
+}
+
+__weak void FwkLiveness_LatencyHandler(FwkMsgReceiver_t *pRxer,
+				       uint32_t WaitMs)
+{
+	LOG_WRN("Receiver %u message waited %u ms", pRxer->id, WaitMs);
+}
+
+bool FwkLiveness_Healthy(void)
+{
+	return atomic_get(&healthy) != 0;
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int FwkLiveness_Initialize(const struct device *device)
+{
+	ARG_UNUSED(device);
+
+#ifdef CONFIG_FWK_LIVENESS_TASK_WDT
+	/* The application initializes the task watchdog (task_wdt_init) */
+	wdtChannel = task_wdt_add(CONFIG_FWK_LIVENESS_WDT_TIMEOUT_MS, NULL,
+				  NULL);
+	if (wdtChannel < 0) {
+		LOG_ERR("Unable to add watchdog channel %d", wdtChannel);
+	}
+#endif
+
+	k_work_schedule(&monitorWork, K_MSEC(CONFIG_FWK_LIVENESS_PERIOD_MS));
+
+	return 0;
+}
+
+static void MonitorHandler(struct k_work *pWork)
+{
+	bool ok = true;
+
+	Framework_ForEachReceiver(CheckReceiver, &ok);
+
+	atomic_set(&healthy, ok ? 1 : 0);
+
+#ifdef CONFIG_FWK_LIVENESS_TASK_WDT
+	if (ok && wdtChannel >= 0) {
+		task_wdt_feed(wdtChannel);
+	}
+#endif
+
+	k_work_schedule(k_work_delayable_from_work(pWork),
+			K_MSEC(CONFIG_FWK_LIVENESS_PERIOD_MS));
+}
+
+static void CheckReceiver(FwkMsgReceiver_t *pRxer, void *pContext)
+{
+	bool *pOk = pContext;
+	uint32_t progress = (uint32_t)atomic_get(&pRxer->progress);
+	uint32_t waitingMs = (uint32_t)atomic_get(&pRxer->waitingMs);
+	uint32_t waitMs;
+
+	if (waitingMs != 0) {
+		waitMs = k_uptime_get_32() - waitingMs;
+		if (waitMs > CONFIG_FWK_LIVENESS_STALL_MS &&
+		    progress == pRxer->lastProgress) {
+			FwkLiveness_StallHandler(pRxer, waitMs);
+			*pOk = false;
+		} else if (waitMs > CONFIG_FWK_LIVENESS_LATENCY_MS) {
+			/* Slow, but not a reason to reset */
+			FwkLiveness_LatencyHandler(pRxer, waitMs);
+		}
+	}
+
+	pRxer->lastProgress = progress;
+}
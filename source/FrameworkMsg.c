@@ -202,6 +202,6 @@ BaseType_t FwkMsg_FilteredTargetedSend(FwkMsg_t *pMsg, FwkId_t *TargetID,
 static void DeallocateOnError(FwkMsg_t *pMsg, BaseType_t status)
 {
 	if (status != FWK_SUCCESS) {
-		BufferPool_Free(pMsg);
+		Framework_FreeMsg(pMsg);
 	}
 }
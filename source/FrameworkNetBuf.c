@@ -0,0 +1,89 @@
+/**
+ * @file FrameworkNetBuf.c
+ * @brief Framework messages that carry a net_buf without copying it.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define FWK_FNAME "FrameworkNetBuf"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "BufferPool.h"
+#include "Framework.h"
+#include "FrameworkMsg.h"
+#include "FrameworkNetBuf.h"
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+FwkNetBufMsg_t *FwkNetBufMsg_Create(FwkId_t TxId, FwkMsgCode_t Code,
+				    struct net_buf *pBuf)
+{
+	FwkNetBufMsg_t *pMsg;
+
+	if (pBuf == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+	pMsg = BP_TRY_TO_TAKE(sizeof(FwkNetBufMsg_t));
+	if (pMsg != NULL) {
+		FRAMEWORK_MSG_HEADER_INIT(pMsg, Code, TxId);
+		pMsg->header.options = FWK_MSG_OPTION_NET_BUF;
+		pMsg->pBuf = net_buf_ref(pBuf);
+	}
+
+	return pMsg;
+}
+
+struct net_buf *FwkNetBufMsg_Detach(FwkNetBufMsg_t *pMsg)
+{
+	struct net_buf *pBuf;
+
+	if (pMsg == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+	pBuf = pMsg->pBuf;
+	pMsg->pBuf = NULL;
+
+	return pBuf;
+}
+
+FwkNetBufMsg_t *FwkNetBufMsg_Clone(const FwkNetBufMsg_t *pMsg)
+{
+	FwkNetBufMsg_t *pCopy;
+
+	if (pMsg == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+	pCopy = BP_TRY_TO_TAKE(sizeof(FwkNetBufMsg_t));
+	if (pCopy != NULL) {
+		*pCopy = *pMsg;
+		if (pCopy->pBuf != NULL) {
+			net_buf_ref(pCopy->pBuf);
+		}
+	}
+
+	return pCopy;
+}
+
+void FwkNetBufMsg_Free(FwkNetBufMsg_t *pMsg)
+{
+	if (pMsg == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	if (pMsg->pBuf != NULL) {
+		net_buf_unref(pMsg->pBuf);
+		pMsg->pBuf = NULL;
+	}
+	BufferPool_Free(pMsg);
+}
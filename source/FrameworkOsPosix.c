@@ -0,0 +1,1063 @@
+/**
+ * @file FrameworkOsPosix.c
+ * @brief The subset of the Zephyr kernel API used by the framework,
+ * implemented with POSIX threads.
+ *
+ * When CONFIG_FWK_POSIX_VIRTUAL_TIME is enabled, only one thread runs at a
+ * time.  The running thread keeps running until it blocks, yields, or makes
+ * a thread with a higher priority ready.  The next thread is the ready
+ * thread with the highest priority that has been ready the longest.  When no
+ * thread is ready, the clock jumps to the next timer expiry or timeout.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define _GNU_SOURCE
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <sched.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FrameworkOs.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+/* Deadline of a wait that doesn't time out */
+#define DEADLINE_FOREVER INT64_MAX
+
+/* Precedes each heap allocation */
+typedef struct HeapChunk {
+	void *pRaw; /** pointer returned by malloc */
+	size_t charge; /** bytes charged to the heap */
+} HeapChunk_t;
+
+#define CHUNK_ALIGN (2 * sizeof(void *))
+#define CHUNK_SIZE ROUND_UP(sizeof(HeapChunk_t), CHUNK_ALIGN)
+
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+enum SimState { SIM_READY = 0, SIM_RUNNING, SIM_WAITING };
+#endif
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int64_t Deadline(k_timeout_t Timeout);
+static int Wait(pthread_cond_t *pCond, pthread_mutex_t *pMutex,
+		int64_t Deadline);
+static void Wake(pthread_cond_t *pCond, bool All);
+static void *ThreadMain(void *pArg);
+static struct k_timer *NextTimer(void);
+static bool FireTimer(int64_t Now);
+static void RemoveTimer(struct k_timer *pTimer);
+
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+static void SimInit(void);
+static struct k_thread *SimSelf(void);
+static void SimAdd(struct k_thread *pThread, int64_t WakeAt);
+static void SimRemove(struct k_thread *pThread);
+static void SimReady(struct k_thread *pThread);
+static struct k_thread *SimBestReady(void);
+static void SimSwitch(struct k_thread *pSelf);
+static void SimAdvance(void);
+static void Preempt(void);
+#else
+static void StartTimerThread(void);
+static void *TimerThread(void *pArg);
+#define Preempt()
+#endif
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static pthread_mutex_t irqMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static pthread_mutex_t logMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t timerMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct k_timer *pActiveTimers;
+
+#ifndef CONFIG_FWK_POSIX_VIRTUAL_TIME
+static pthread_cond_t timerCond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t timerOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static __thread struct k_thread *pCurrent;
+static __thread struct k_thread foreignThread;
+static __thread bool inIsr;
+static __thread int locks; /** spinlocks and irq locks held */
+
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+/* Protects the scheduler state (threads and the clock) */
+static pthread_mutex_t simMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct k_thread *pSimThreads; /** in the order they were added */
+static struct k_thread *pSimRunning;
+static uint64_t simSeq;
+static int64_t simNow;
+#endif
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void FwkOs_Log(const char *tag, const char *module, const char *fmt, ...)
+{
+	va_list args;
+
+	pthread_mutex_lock(&logMutex);
+	fprintf(stderr, "[%08u] <%s> %s: ", k_uptime_get_32(), tag, module);
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+	pthread_mutex_unlock(&logMutex);
+}
+
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+int64_t k_uptime_ticks(void)
+{
+	return __atomic_load_n(&simNow, __ATOMIC_SEQ_CST);
+}
+#else
+int64_t k_uptime_ticks(void)
+{
+	static int64_t start;
+	struct timespec ts;
+	int64_t now;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = ((int64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+
+	/* Uptime starts at zero (like a target) */
+	if (__atomic_load_n(&start, __ATOMIC_RELAXED) == 0) {
+		int64_t expected = 0;
+
+		__atomic_compare_exchange_n(&start, &expected, now - 1, false,
+					    __ATOMIC_SEQ_CST,
+					    __ATOMIC_SEQ_CST);
+	}
+
+	return now - __atomic_load_n(&start, __ATOMIC_RELAXED);
+}
+#endif
+
+int64_t k_uptime_get(void)
+{
+	return k_uptime_ticks();
+}
+
+uint32_t k_uptime_get_32(void)
+{
+	return (uint32_t)k_uptime_ticks();
+}
+
+int32_t k_sleep(k_timeout_t timeout)
+{
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+	int64_t deadline = Deadline(timeout);
+
+	pthread_mutex_lock(&mutex);
+	while (Wait(&cond, &mutex, deadline) == 0) {
+	}
+	pthread_mutex_unlock(&mutex);
+
+	return 0;
+}
+
+int32_t k_msleep(int32_t ms)
+{
+	return k_sleep(K_MSEC(ms));
+}
+
+void k_yield(void)
+{
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+	struct k_thread *pSelf;
+
+	pthread_mutex_lock(&simMutex);
+	pSelf = SimSelf();
+	SimReady(pSelf);
+	SimSwitch(pSelf);
+	pthread_mutex_unlock(&simMutex);
+#else
+	sched_yield();
+#endif
+}
+
+k_spinlock_key_t k_spin_lock(struct k_spinlock *l)
+{
+	k_spinlock_key_t key = { 0 };
+
+	pthread_mutex_lock(&l->mutex);
+	locks += 1;
+	return key;
+}
+
+void k_spin_unlock(struct k_spinlock *l, k_spinlock_key_t key)
+{
+	ARG_UNUSED(key);
+	locks -= 1;
+	pthread_mutex_unlock(&l->mutex);
+}
+
+unsigned int irq_lock(void)
+{
+	pthread_mutex_lock(&irqMutex);
+	locks += 1;
+	return 0;
+}
+
+void irq_unlock(unsigned int key)
+{
+	ARG_UNUSED(key);
+	locks -= 1;
+	pthread_mutex_unlock(&irqMutex);
+}
+
+bool k_is_in_isr(void)
+{
+	return inIsr;
+}
+
+k_tid_t k_thread_create(struct k_thread *new_thread, k_thread_stack_t *stack,
+			size_t stack_size, k_thread_entry_t entry, void *p1,
+			void *p2, void *p3, int prio, uint32_t options,
+			k_timeout_t delay)
+{
+	ARG_UNUSED(stack);
+	ARG_UNUSED(stack_size);
+	ARG_UNUSED(options);
+
+	new_thread->entry = entry;
+	new_thread->p1 = p1;
+	new_thread->p2 = p2;
+	new_thread->p3 = p3;
+	new_thread->prio = prio;
+	new_thread->delay = delay;
+
+	if (!K_TIMEOUT_EQ(delay, K_FOREVER)) {
+		k_thread_start(new_thread);
+	}
+
+	return new_thread;
+}
+
+void k_thread_start(k_tid_t thread)
+{
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+	/* The thread is added by its creator so that the order is known */
+	pthread_mutex_lock(&simMutex);
+	SimAdd(thread, (thread->delay.ticks > 0) ?
+			       (simNow + thread->delay.ticks) :
+			       simNow);
+	pthread_mutex_unlock(&simMutex);
+#endif
+
+	if (pthread_create(&thread->thread, NULL, ThreadMain, thread) != 0) {
+		fprintf(stderr, "Unable to create thread\n");
+		abort();
+	}
+	pthread_detach(thread->thread);
+
+	Preempt();
+}
+
+k_tid_t k_current_get(void)
+{
+	/* Threads that weren't created by k_thread_create (main) */
+	if (pCurrent == NULL) {
+		foreignThread.thread = pthread_self();
+		pCurrent = &foreignThread;
+	}
+
+	return pCurrent;
+}
+
+int k_thread_name_set(k_tid_t thread, const char *name)
+{
+	char shortName[16];
+
+	if (thread == NULL) {
+		thread = k_current_get();
+	}
+
+	strncpy(thread->name, name, sizeof(thread->name) - 1);
+	strncpy(shortName, name, sizeof(shortName) - 1);
+	shortName[sizeof(shortName) - 1] = '\0';
+
+	return pthread_setname_np(thread->thread, shortName);
+}
+
+int k_thread_priority_get(k_tid_t thread)
+{
+	return thread->prio;
+}
+
+void k_thread_priority_set(k_tid_t thread, int prio)
+{
+	thread->prio = prio;
+	Preempt();
+}
+
+void k_msgq_init(struct k_msgq *msgq, char *buffer, size_t msg_size,
+		 uint32_t max_msgs)
+{
+	pthread_mutex_init(&msgq->lock, NULL);
+	pthread_cond_init(&msgq->notEmpty, NULL);
+	pthread_cond_init(&msgq->notFull, NULL);
+	msgq->buffer_start = buffer;
+	msgq->msg_size = msg_size;
+	msgq->max_msgs = max_msgs;
+	msgq->read_index = 0;
+	msgq->used_msgs = 0;
+}
+
+int k_msgq_put(struct k_msgq *msgq, const void *data, k_timeout_t timeout)
+{
+	int64_t deadline = Deadline(timeout);
+	uint32_t write;
+	int r = 0;
+
+	pthread_mutex_lock(&msgq->lock);
+	while (msgq->used_msgs == msgq->max_msgs && r == 0) {
+		r = Wait(&msgq->notFull, &msgq->lock, deadline);
+	}
+
+	if (msgq->used_msgs < msgq->max_msgs) {
+		write = (msgq->read_index + msgq->used_msgs) % msgq->max_msgs;
+		memcpy(msgq->buffer_start + (write * msgq->msg_size), data,
+		       msgq->msg_size);
+		msgq->used_msgs += 1;
+		Wake(&msgq->notEmpty, false);
+		r = 0;
+	} else {
+		r = K_TIMEOUT_EQ(timeout, K_NO_WAIT) ? -ENOMSG : -EAGAIN;
+	}
+	pthread_mutex_unlock(&msgq->lock);
+
+	Preempt();
+
+	return r;
+}
+
+int k_msgq_get(struct k_msgq *msgq, void *data, k_timeout_t timeout)
+{
+	int64_t deadline = Deadline(timeout);
+	int r = 0;
+
+	pthread_mutex_lock(&msgq->lock);
+	while (msgq->used_msgs == 0 && r == 0) {
+		r = Wait(&msgq->notEmpty, &msgq->lock, deadline);
+	}
+
+	if (msgq->used_msgs > 0) {
+		memcpy(data,
+		       msgq->buffer_start +
+			       (msgq->read_index * msgq->msg_size),
+		       msgq->msg_size);
+		msgq->read_index = (msgq->read_index + 1) % msgq->max_msgs;
+		msgq->used_msgs -= 1;
+		Wake(&msgq->notFull, false);
+		r = 0;
+	} else {
+		r = K_TIMEOUT_EQ(timeout, K_NO_WAIT) ? -ENOMSG : -EAGAIN;
+	}
+	pthread_mutex_unlock(&msgq->lock);
+
+	Preempt();
+
+	return r;
+}
+
+int k_msgq_peek(struct k_msgq *msgq, void *data)
+{
+	int r = -ENOMSG;
+
+	pthread_mutex_lock(&msgq->lock);
+	if (msgq->used_msgs > 0) {
+		memcpy(data,
+		       msgq->buffer_start +
+			       (msgq->read_index * msgq->msg_size),
+		       msgq->msg_size);
+		r = 0;
+	}
+	pthread_mutex_unlock(&msgq->lock);
+
+	return r;
+}
+
+void k_msgq_purge(struct k_msgq *msgq)
+{
+	pthread_mutex_lock(&msgq->lock);
+	msgq->used_msgs = 0;
+	Wake(&msgq->notFull, true);
+	pthread_mutex_unlock(&msgq->lock);
+
+	Preempt();
+}
+
+uint32_t k_msgq_num_free_get(struct k_msgq *msgq)
+{
+	uint32_t n;
+
+	pthread_mutex_lock(&msgq->lock);
+	n = msgq->max_msgs - msgq->used_msgs;
+	pthread_mutex_unlock(&msgq->lock);
+
+	return n;
+}
+
+uint32_t k_msgq_num_used_get(struct k_msgq *msgq)
+{
+	uint32_t n;
+
+	pthread_mutex_lock(&msgq->lock);
+	n = msgq->used_msgs;
+	pthread_mutex_unlock(&msgq->lock);
+
+	return n;
+}
+
+void k_msgq_get_attrs(struct k_msgq *msgq, struct k_msgq_attrs *attrs)
+{
+	pthread_mutex_lock(&msgq->lock);
+	attrs->msg_size = msgq->msg_size;
+	attrs->max_msgs = msgq->max_msgs;
+	attrs->used_msgs = msgq->used_msgs;
+	pthread_mutex_unlock(&msgq->lock);
+}
+
+void *k_heap_alloc(struct k_heap *h, size_t bytes, k_timeout_t timeout)
+{
+	return k_heap_aligned_alloc(h, CHUNK_ALIGN, bytes, timeout);
+}
+
+void *k_heap_aligned_alloc(struct k_heap *h, size_t align, size_t bytes,
+			   k_timeout_t timeout)
+{
+	int64_t deadline = Deadline(timeout);
+	size_t charge = CHUNK_SIZE + ROUND_UP(bytes, CHUNK_ALIGN);
+	HeapChunk_t *pChunk;
+	uint8_t *pRaw;
+	uint8_t *pMem;
+	int r = 0;
+
+	align = MAX(align, CHUNK_ALIGN);
+
+	pthread_mutex_lock(&h->lock.mutex);
+	while ((h->used + charge) > h->capacity && r == 0) {
+		r = Wait(&h->freed, &h->lock.mutex, deadline);
+	}
+	if ((h->used + charge) > h->capacity) {
+		pthread_mutex_unlock(&h->lock.mutex);
+		return NULL;
+	}
+	h->used += charge;
+	pthread_mutex_unlock(&h->lock.mutex);
+
+	pRaw = malloc(CHUNK_SIZE + align + bytes);
+	if (pRaw == NULL) {
+		pthread_mutex_lock(&h->lock.mutex);
+		h->used -= charge;
+		pthread_mutex_unlock(&h->lock.mutex);
+		return NULL;
+	}
+
+	pMem = (uint8_t *)ROUND_UP(pRaw + CHUNK_SIZE, align);
+	pChunk = (HeapChunk_t *)(pMem - CHUNK_SIZE);
+	pChunk->pRaw = pRaw;
+	pChunk->charge = charge;
+
+	return pMem;
+}
+
+void k_heap_free(struct k_heap *h, void *mem)
+{
+	HeapChunk_t *pChunk;
+
+	if (mem == NULL) {
+		return;
+	}
+
+	pChunk = (HeapChunk_t *)((uint8_t *)mem - CHUNK_SIZE);
+
+	pthread_mutex_lock(&h->lock.mutex);
+	h->used -= pChunk->charge;
+	Wake(&h->freed, true);
+	pthread_mutex_unlock(&h->lock.mutex);
+
+	free(pChunk->pRaw);
+
+	Preempt();
+}
+
+int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem,
+		     k_timeout_t timeout)
+{
+	int64_t deadline = Deadline(timeout);
+	int r = 0;
+
+	pthread_mutex_lock(&slab->lock);
+	while (slab->num_used == slab->num_blocks && r == 0) {
+		r = Wait(&slab->freed, &slab->lock, deadline);
+	}
+
+	if (slab->num_used < slab->num_blocks) {
+		if (slab->free_list != NULL) {
+			*mem = slab->free_list;
+			slab->free_list = *((char **)slab->free_list);
+		} else {
+			*mem = slab->buffer +
+			       ((size_t)slab->num_carved * slab->block_size);
+			slab->num_carved += 1;
+		}
+		slab->num_used += 1;
+		r = 0;
+	} else {
+		*mem = NULL;
+		r = K_TIMEOUT_EQ(timeout, K_NO_WAIT) ? -ENOMEM : -EAGAIN;
+	}
+	pthread_mutex_unlock(&slab->lock);
+
+	return r;
+}
+
+void k_mem_slab_free(struct k_mem_slab *slab, void *mem)
+{
+	pthread_mutex_lock(&slab->lock);
+	*((char **)mem) = slab->free_list;
+	slab->free_list = mem;
+	slab->num_used -= 1;
+	Wake(&slab->freed, false);
+	pthread_mutex_unlock(&slab->lock);
+
+	Preempt();
+}
+
+uint32_t k_mem_slab_num_used_get(struct k_mem_slab *slab)
+{
+	uint32_t used;
+
+	pthread_mutex_lock(&slab->lock);
+	used = slab->num_used;
+	pthread_mutex_unlock(&slab->lock);
+
+	return used;
+}
+
+uint32_t k_mem_slab_num_free_get(struct k_mem_slab *slab)
+{
+	return slab->num_blocks - k_mem_slab_num_used_get(slab);
+}
+
+void k_timer_init(struct k_timer *timer,
+		  void (*expiry_fn)(struct k_timer *timer),
+		  void (*stop_fn)(struct k_timer *timer))
+{
+	memset(timer, 0, sizeof(*timer));
+	timer->expiry_fn = expiry_fn;
+	timer->stop_fn = stop_fn;
+}
+
+void k_timer_start(struct k_timer *timer, k_timeout_t duration,
+		   k_timeout_t period)
+{
+#ifndef CONFIG_FWK_POSIX_VIRTUAL_TIME
+	pthread_once(&timerOnce, StartTimerThread);
+#endif
+
+	pthread_mutex_lock(&timerMutex);
+	RemoveTimer(timer);
+	timer->status = 0;
+	if (!K_TIMEOUT_EQ(duration, K_FOREVER)) {
+		timer->expiry = k_uptime_ticks() + MAX(duration.ticks, 0);
+		timer->period = K_TIMEOUT_EQ(period, K_FOREVER) ?
+					0 :
+					MAX(period.ticks, 0);
+		timer->next = pActiveTimers;
+		timer->active = true;
+		pActiveTimers = timer;
+#ifndef CONFIG_FWK_POSIX_VIRTUAL_TIME
+		pthread_cond_signal(&timerCond);
+#endif
+	}
+	pthread_mutex_unlock(&timerMutex);
+}
+
+void k_timer_stop(struct k_timer *timer)
+{
+	bool wasActive;
+
+	pthread_mutex_lock(&timerMutex);
+	wasActive = timer->active;
+	RemoveTimer(timer);
+	pthread_mutex_unlock(&timerMutex);
+
+	if (wasActive && timer->stop_fn != NULL) {
+		timer->stop_fn(timer);
+	}
+}
+
+uint32_t k_timer_status_get(struct k_timer *timer)
+{
+	uint32_t status;
+
+	pthread_mutex_lock(&timerMutex);
+	status = timer->status;
+	timer->status = 0;
+	pthread_mutex_unlock(&timerMutex);
+
+	return status;
+}
+
+void sys_reboot(int type)
+{
+	ARG_UNUSED(type);
+
+	fflush(NULL);
+	abort();
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static int64_t Deadline(k_timeout_t Timeout)
+{
+	if (K_TIMEOUT_EQ(Timeout, K_FOREVER)) {
+		return DEADLINE_FOREVER;
+	}
+
+	return k_uptime_ticks() + MAX(Timeout.ticks, 0);
+}
+
+/**
+ * @brief Wait on a condition until it is signaled or the deadline passes.
+ *
+ * @retval 0 if signaled (or spurious wakeup), -EAGAIN if the deadline passed
+ */
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+static int Wait(pthread_cond_t *pCond, pthread_mutex_t *pMutex,
+		int64_t Deadline)
+{
+	struct k_thread *pSelf;
+	bool timedOut;
+
+	if (Deadline <= k_uptime_ticks()) {
+		return -EAGAIN;
+	}
+
+	/* The condition is only used to identify the waiters */
+	pthread_mutex_lock(&simMutex);
+	pSelf = SimSelf();
+	pSelf->state = SIM_WAITING;
+	pSelf->pChannel = pCond;
+	pSelf->wakeAt = Deadline;
+	pSelf->timedOut = false;
+	pSelf->seq = simSeq++;
+	pthread_mutex_unlock(pMutex);
+
+	SimSwitch(pSelf);
+	timedOut = pSelf->timedOut;
+	pthread_mutex_unlock(&simMutex);
+
+	pthread_mutex_lock(pMutex);
+
+	return timedOut ? -EAGAIN : 0;
+}
+#else
+static int Wait(pthread_cond_t *pCond, pthread_mutex_t *pMutex,
+		int64_t Deadline)
+{
+	struct timespec ts;
+	int64_t remaining;
+
+	if (Deadline == DEADLINE_FOREVER) {
+		pthread_cond_wait(pCond, pMutex);
+		return 0;
+	}
+
+	remaining = Deadline - k_uptime_ticks();
+	if (remaining <= 0) {
+		return -EAGAIN;
+	}
+
+	/* Condition variables that are statically initialized use this clock */
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += remaining / 1000;
+	ts.tv_nsec += (remaining % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec += 1;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	pthread_cond_timedwait(pCond, pMutex, &ts);
+
+	return 0;
+}
+#endif
+
+/**
+ * @brief Wake the thread that has waited the longest (or all threads)
+ * on a condition.  Called with the lock of the condition held.
+ */
+static void Wake(pthread_cond_t *pCond, bool All)
+{
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+	struct k_thread *pThread;
+	struct k_thread *pFirst = NULL;
+
+	pthread_mutex_lock(&simMutex);
+	for (pThread = pSimThreads; pThread != NULL;
+	     pThread = pThread->pSimNext) {
+		if (pThread->state != SIM_WAITING ||
+		    pThread->pChannel != pCond) {
+			continue;
+		}
+		if (All) {
+			SimReady(pThread);
+		} else if (pFirst == NULL || pThread->seq < pFirst->seq) {
+			pFirst = pThread;
+		}
+	}
+	if (pFirst != NULL) {
+		SimReady(pFirst);
+	}
+	pthread_mutex_unlock(&simMutex);
+#else
+	if (All) {
+		pthread_cond_broadcast(pCond);
+	} else {
+		pthread_cond_signal(pCond);
+	}
+#endif
+}
+
+static void *ThreadMain(void *pArg)
+{
+	struct k_thread *pThread = pArg;
+
+	pCurrent = pThread;
+
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+	/* The start delay is a timeout of the scheduler */
+	pthread_mutex_lock(&simMutex);
+	while (pSimRunning != pThread) {
+		pthread_cond_wait(&pThread->run, &simMutex);
+	}
+	pthread_mutex_unlock(&simMutex);
+#else
+	if (pThread->delay.ticks > 0) {
+		k_sleep(pThread->delay);
+	}
+#endif
+
+	pThread->entry(pThread->p1, pThread->p2, pThread->p3);
+
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+	pthread_mutex_lock(&simMutex);
+	SimRemove(pThread);
+	SimSwitch(NULL);
+	pthread_mutex_unlock(&simMutex);
+#endif
+
+	return NULL;
+}
+
+/* Called with the timer lock held */
+static struct k_timer *NextTimer(void)
+{
+	struct k_timer *pTimer;
+	struct k_timer *pNext = NULL;
+
+	for (pTimer = pActiveTimers; pTimer != NULL; pTimer = pTimer->next) {
+		if (pNext == NULL || pTimer->expiry < pNext->expiry) {
+			pNext = pTimer;
+		}
+	}
+
+	return pNext;
+}
+
+/**
+ * @brief Expires the next timer if it is due.  The expiry function is called
+ * without the timer lock held and is treated as an interrupt.
+ *
+ * @retval true if a timer expired
+ */
+static bool FireTimer(int64_t Now)
+{
+	struct k_timer *pTimer;
+
+	pthread_mutex_lock(&timerMutex);
+	pTimer = NextTimer();
+	if (pTimer == NULL || pTimer->expiry > Now) {
+		pthread_mutex_unlock(&timerMutex);
+		return false;
+	}
+
+	pTimer->status += 1;
+	if (pTimer->period > 0) {
+		pTimer->expiry += pTimer->period;
+	} else {
+		RemoveTimer(pTimer);
+	}
+	pthread_mutex_unlock(&timerMutex);
+
+	if (pTimer->expiry_fn != NULL) {
+		inIsr = true;
+		pTimer->expiry_fn(pTimer);
+		inIsr = false;
+	}
+
+	return true;
+}
+
+/* Called with the timer lock held */
+static void RemoveTimer(struct k_timer *pTimer)
+{
+	struct k_timer **ppTimer;
+
+	for (ppTimer = &pActiveTimers; *ppTimer != NULL;
+	     ppTimer = &(*ppTimer)->next) {
+		if (*ppTimer == pTimer) {
+			*ppTimer = pTimer->next;
+			break;
+		}
+	}
+	pTimer->next = NULL;
+	pTimer->active = false;
+}
+
+#ifdef CONFIG_FWK_POSIX_VIRTUAL_TIME
+/* The main thread runs first (before SYS_INIT functions) */
+static void __attribute__((constructor(101))) SimInit(void)
+{
+	pthread_mutex_lock(&simMutex);
+	(void)SimSelf();
+	pthread_mutex_unlock(&simMutex);
+}
+
+/**
+ * @brief Returns the current thread.  A thread that wasn't created with
+ * k_thread_create is added when it first uses the scheduler.
+ * Called with the scheduler lock held.
+ */
+static struct k_thread *SimSelf(void)
+{
+	struct k_thread *pSelf = k_current_get();
+
+	if (!pSelf->simAdded) {
+		SimAdd(pSelf, simNow);
+		if (pSimRunning == NULL) {
+			pSimRunning = pSelf;
+			pSelf->state = SIM_RUNNING;
+		}
+		while (pSimRunning != pSelf) {
+			pthread_cond_wait(&pSelf->run, &simMutex);
+		}
+	}
+
+	return pSelf;
+}
+
+/* Adds a thread that is ready at WakeAt */
+static void SimAdd(struct k_thread *pThread, int64_t WakeAt)
+{
+	struct k_thread **ppThread = &pSimThreads;
+
+	pthread_cond_init(&pThread->run, NULL);
+	pThread->pSimNext = NULL;
+	pThread->pChannel = NULL;
+	pThread->wakeAt = WakeAt;
+	pThread->simAdded = true;
+	if (WakeAt > simNow) {
+		pThread->state = SIM_WAITING;
+		pThread->seq = simSeq++;
+	} else {
+		SimReady(pThread);
+	}
+
+	while (*ppThread != NULL) {
+		ppThread = &(*ppThread)->pSimNext;
+	}
+	*ppThread = pThread;
+}
+
+static void SimRemove(struct k_thread *pThread)
+{
+	struct k_thread **ppThread;
+
+	for (ppThread = &pSimThreads; *ppThread != NULL;
+	     ppThread = &(*ppThread)->pSimNext) {
+		if (*ppThread == pThread) {
+			*ppThread = pThread->pSimNext;
+			break;
+		}
+	}
+	pThread->simAdded = false;
+}
+
+static void SimReady(struct k_thread *pThread)
+{
+	pThread->state = SIM_READY;
+	pThread->pChannel = NULL;
+	pThread->seq = simSeq++;
+}
+
+/* Highest priority (lowest value), then ready the longest */
+static struct k_thread *SimBestReady(void)
+{
+	struct k_thread *pThread;
+	struct k_thread *pBest = NULL;
+
+	for (pThread = pSimThreads; pThread != NULL;
+	     pThread = pThread->pSimNext) {
+		if (pThread->state != SIM_READY) {
+			continue;
+		}
+		if (pBest == NULL || pThread->prio < pBest->prio ||
+		    (pThread->prio == pBest->prio &&
+		     pThread->seq < pBest->seq)) {
+			pBest = pThread;
+		}
+	}
+
+	return pBest;
+}
+
+/**
+ * @brief Runs the next thread and waits until pSelf (if not NULL) runs
+ * again.  The caller has changed the state of pSelf.
+ * Called with the scheduler lock held.
+ */
+static void SimSwitch(struct k_thread *pSelf)
+{
+	struct k_thread *pNext;
+
+	while ((pNext = SimBestReady()) == NULL) {
+		SimAdvance();
+	}
+
+	pNext->state = SIM_RUNNING;
+	pSimRunning = pNext;
+	if (pNext != pSelf) {
+		pthread_cond_signal(&pNext->run);
+	}
+
+	while (pSelf != NULL && pSimRunning != pSelf) {
+		pthread_cond_wait(&pSelf->run, &simMutex);
+	}
+}
+
+/**
+ * @brief No thread is ready.  Jump to the next timer expiry or timeout.
+ * The calling thread runs the expiry functions.
+ * Called with the scheduler lock held.
+ */
+static void SimAdvance(void)
+{
+	struct k_thread *pThread;
+	struct k_timer *pTimer;
+	int64_t next = DEADLINE_FOREVER;
+
+	for (pThread = pSimThreads; pThread != NULL;
+	     pThread = pThread->pSimNext) {
+		if (pThread->state == SIM_WAITING) {
+			next = MIN(next, pThread->wakeAt);
+		}
+	}
+
+	pthread_mutex_lock(&timerMutex);
+	pTimer = NextTimer();
+	if (pTimer != NULL) {
+		next = MIN(next, pTimer->expiry);
+	}
+	pthread_mutex_unlock(&timerMutex);
+
+	if (next == DEADLINE_FOREVER) {
+		fprintf(stderr, "All threads are waiting forever at %lld ms\n",
+			(long long)simNow);
+		abort();
+	}
+
+	if (next > simNow) {
+		__atomic_store_n(&simNow, next, __ATOMIC_SEQ_CST);
+	}
+
+	/* Expiry functions can send messages (and wake threads) */
+	pthread_mutex_unlock(&simMutex);
+	while (FireTimer(simNow)) {
+	}
+	pthread_mutex_lock(&simMutex);
+
+	for (pThread = pSimThreads; pThread != NULL;
+	     pThread = pThread->pSimNext) {
+		if (pThread->state == SIM_WAITING &&
+		    pThread->wakeAt <= simNow) {
+			SimReady(pThread);
+			pThread->timedOut = true;
+		}
+	}
+}
+
+/**
+ * @brief Runs a thread with a higher priority if one is ready.
+ * Threads with a negative (cooperative) priority and threads that hold a
+ * lock aren't preempted.
+ */
+static void Preempt(void)
+{
+	struct k_thread *pSelf;
+	struct k_thread *pBest;
+
+	if (inIsr || locks > 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&simMutex);
+	pSelf = SimSelf();
+	pBest = SimBestReady();
+	if (pSelf->prio >= 0 && pBest != NULL && pBest->prio < pSelf->prio) {
+		SimReady(pSelf);
+		SimSwitch(pSelf);
+	}
+	pthread_mutex_unlock(&simMutex);
+}
+#else
+static void StartTimerThread(void)
+{
+	pthread_t thread;
+
+	if (pthread_create(&thread, NULL, TimerThread, NULL) != 0) {
+		fprintf(stderr, "Unable to create timer thread\n");
+		abort();
+	}
+	pthread_setname_np(thread, "fwk_timer");
+	pthread_detach(thread);
+}
+
+static void *TimerThread(void *pArg)
+{
+	struct k_timer *pNext;
+
+	ARG_UNUSED(pArg);
+
+	while (true) {
+		while (FireTimer(k_uptime_ticks())) {
+		}
+
+		pthread_mutex_lock(&timerMutex);
+		pNext = NextTimer();
+		Wait(&timerCond, &timerMutex,
+		     (pNext == NULL) ? DEADLINE_FOREVER : pNext->expiry);
+		pthread_mutex_unlock(&timerMutex);
+	}
+
+	return NULL;
+}
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file FrameworkPoll.c
+ * @brief One thread servicing several receiver queues and kernel events.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define FWK_FNAME "FrameworkPoll"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include "Framework.h"
+#include "FrameworkPoll.h"
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static int ServiceSource(FwkPollSource_t *pSource);
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+int FwkPoll_Init(FwkPollSet_t *pSet)
+{
+	size_t i;
+
+	if (pSet == NULL || pSet->pEvents == NULL ||
+	    (pSet->sourceCount > 0 && pSet->pSources == NULL) ||
+	    (pSet->eventCount > 0 && pSet->eventHandler == NULL)) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < pSet->sourceCount; i++) {
+		if (pSet->pSources[i].pRxer == NULL) {
+			FRAMEWORK_ASSERT(FORCED);
+			return -EINVAL;
+		}
+		k_poll_event_init(&pSet->pEvents[i],
+				  K_POLL_TYPE_MSGQ_DATA_AVAILABLE,
+				  K_POLL_MODE_NOTIFY_ONLY,
+				  pSet->pSources[i].pRxer->pQueue);
+	}
+
+	pSet->first = 0;
+
+	return 0;
+}
+
+int FwkPoll_Service(FwkPollSet_t *pSet, k_timeout_t Timeout)
+{
+	struct k_poll_event *pEvent;
+	size_t total;
+	size_t i;
+	size_t j;
+	int count = 0;
+
+	if (pSet == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+
+	total = pSet->sourceCount + pSet->eventCount;
+
+	if (k_poll(pSet->pEvents, total, Timeout) != 0) {
+		return -EAGAIN;
+	}
+
+	for (i = 0; i < pSet->sourceCount; i++) {
+		j = (pSet->first + i) % pSet->sourceCount;
+		pEvent = &pSet->pEvents[j];
+		if (pEvent->state & K_POLL_STATE_MSGQ_DATA_AVAILABLE) {
+			count += ServiceSource(&pSet->pSources[j]);
+		}
+		pEvent->state = K_POLL_STATE_NOT_READY;
+	}
+
+	if (pSet->sourceCount > 0) {
+		pSet->first = (pSet->first + 1) % pSet->sourceCount;
+	}
+
+	for (i = pSet->sourceCount; i < total; i++) {
+		pEvent = &pSet->pEvents[i];
+		if (pEvent->state != K_POLL_STATE_NOT_READY) {
+			pSet->eventHandler(pEvent, pSet->pContext);
+			count += 1;
+		}
+		pEvent->state = K_POLL_STATE_NOT_READY;
+	}
+
+	return count;
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+/**
+ * @brief Dispatch up to weight messages.  Messages that remain keep the
+ * event ready for the next call.
+ */
+static int ServiceSource(FwkPollSource_t *pSource)
+{
+	uint32_t weight = MAX(pSource->weight, 1);
+	FwkMsg_t *pMsg;
+	uint32_t i;
+
+	for (i = 0; i < weight; i++) {
+		pMsg = NULL;
+		Framework_Receive(pSource->pRxer->pQueue, &pMsg, K_NO_WAIT);
+		if (pMsg == NULL) {
+			break;
+		}
+		Framework_DispatchMsg(pSource->pRxer, pMsg);
+	}
+
+	return i;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file FrameworkRecord.c
+ * @brief Records routed messages and replays them.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define FWK_FNAME "FrameworkRecord"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr/sys/ring_buffer.h>
+#include <string.h>
+
+#include "BufferPool.h"
+#include "Framework.h"
+#include "FrameworkRecord.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define ENTRY_SIZE sizeof(FwkRecordEntry_t)
+
+BUILD_ASSERT(CONFIG_FWK_RECORD_MAX_PAYLOAD <= UINT16_MAX,
+	     "Maximum payload must fit in length");
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static FwkMsg_t *CreateMsg(const FwkRecordEntry_t *pEntry,
+			   const uint8_t *pPayload);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+RING_BUF_DECLARE(recordRing, CONFIG_FWK_RECORD_BUFFER_SIZE);
+
+static struct k_spinlock recordLock;
+
+static atomic_t recording;
+static atomic_t replaying;
+
+static FwkRecordSink_t recordSink;
+static void *recordSinkContext;
+
+static FwkRecordStats_t recordStats;
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void FwkRecord_Start(FwkRecordSink_t Sink, void *pContext)
+{
+	k_spinlock_key_t key = k_spin_lock(&recordLock);
+
+	ring_buf_reset(&recordRing);
+	memset(&recordStats, 0, sizeof(recordStats));
+	recordSink = Sink;
+	recordSinkContext = pContext;
+
+	k_spin_unlock(&recordLock, key);
+
+	atomic_set(&recording, 1);
+}
+
+void FwkRecord_Stop(void)
+{
+	atomic_clear(&recording);
+}
+
+size_t FwkRecord_Read(uint8_t *pDest, size_t Size)
+{
+	size_t count;
+
+	if (pDest == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return 0;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&recordLock);
+	count = ring_buf_get(&recordRing, pDest, Size);
+	k_spin_unlock(&recordLock, key);
+
+	return count;
+}
+
+int FwkRecord_Replay(const uint8_t *pLog, size_t Length, bool RealTime)
+{
+	FwkRecordEntry_t entry;
+	BaseType_t result;
+	FwkMsg_t *pMsg;
+	int64_t startMs = k_uptime_get();
+	int64_t delayMs;
+	uint32_t firstMs = 0;
+	bool first = true;
+	size_t offset = 0;
+	int sent = 0;
+
+	if (pLog == NULL && Length > 0) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+
+	atomic_set(&replaying, 1);
+
+	while (offset < Length) {
+		if ((Length - offset) < ENTRY_SIZE) {
+			sent = -EINVAL;
+			break;
+		}
+		memcpy(&entry, &pLog[offset], ENTRY_SIZE);
+		offset += ENTRY_SIZE;
+		if ((Length - offset) < entry.length ||
+		    entry.length > entry.size) {
+			sent = -EINVAL;
+			break;
+		}
+
+		if (first) {
+			firstMs = entry.timeMs;
+			first = false;
+		}
+
+		if (RealTime) {
+			delayMs = (int64_t)(entry.timeMs - firstMs) -
+				  (k_uptime_get() - startMs);
+			if (delayMs > 0) {
+				k_msleep(delayMs);
+			}
+		}
+
+		pMsg = CreateMsg(&entry, &pLog[offset]);
+		offset += entry.length;
+		if (pMsg == NULL) {
+			continue;
+		}
+
+		if (entry.header.rxId == FWK_ID_RESERVED) {
+			result = Framework_Broadcast(
+				pMsg, sizeof(FwkMsgHeader_t) + entry.size);
+		} else {
+			result = Framework_Send(entry.header.rxId, pMsg);
+		}
+
+		if (result == FWK_SUCCESS) {
+			sent += 1;
+		} else {
+			Framework_FreeMsg(pMsg);
+		}
+	}
+
+	atomic_clear(&replaying);
+
+	return sent;
+}
+
+void FwkRecord_GetStats(FwkRecordStats_t *pStats)
+{
+	if (pStats == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&recordLock);
+	*pStats = recordStats;
+	k_spin_unlock(&recordLock, key);
+}
+
+void FwkRecord_Capture(const FwkMsg_t *pMsg, FwkRecordCapture_t *pCapture)
+{
+	FwkRecordEntry_t *pEntry = &pCapture->entry;
+	size_t size;
+
+	pCapture->active = false;
+	if (!atomic_get(&recording) || atomic_get(&replaying)) {
+		return;
+	}
+
+	/* Pointers can't be replayed */
+	if (pMsg->header.options & FWK_MSG_OPTION_LOCAL_ONLY) {
+		k_spinlock_key_t key = k_spin_lock(&recordLock);
+		recordStats.skipped += 1;
+		k_spin_unlock(&recordLock, key);
+		return;
+	}
+
+	size = BufferPool_GetSize(pMsg);
+	size = (size > sizeof(FwkMsgHeader_t)) ?
+		       (size - sizeof(FwkMsgHeader_t)) :
+		       0;
+
+	pEntry->timeMs = k_uptime_get_32();
+	pEntry->header = pMsg->header;
+	pEntry->size = MIN(size, UINT16_MAX);
+	pEntry->length = MIN(size, CONFIG_FWK_RECORD_MAX_PAYLOAD);
+	memcpy(pCapture->payload,
+	       (const uint8_t *)pMsg + sizeof(FwkMsgHeader_t), pEntry->length);
+	pCapture->active = true;
+}
+
+void FwkRecord_Commit(const FwkRecordCapture_t *pCapture, int Status)
+{
+	const FwkRecordEntry_t *pEntry = &pCapture->entry;
+	FwkRecordSink_t sink;
+	void *pContext;
+
+	if (!pCapture->active) {
+		return;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&recordLock);
+
+	if (Status != 0) {
+		recordStats.notQueued += 1;
+		k_spin_unlock(&recordLock, key);
+		return;
+	}
+
+	if (pEntry->length < pEntry->size) {
+		recordStats.truncated += 1;
+	}
+
+	sink = recordSink;
+	pContext = recordSinkContext;
+	if (sink == NULL) {
+		/* Entries are never split */
+		if (ring_buf_space_get(&recordRing) >=
+		    (ENTRY_SIZE + pEntry->length)) {
+			ring_buf_put(&recordRing, (const uint8_t *)pEntry,
+				     ENTRY_SIZE);
+			ring_buf_put(&recordRing, pCapture->payload,
+				     pEntry->length);
+			recordStats.recorded += 1;
+		} else {
+			recordStats.overflows += 1;
+		}
+	} else {
+		recordStats.recorded += 1;
+	}
+
+	k_spin_unlock(&recordLock, key);
+
+	if (sink != NULL) {
+		sink(pEntry, pCapture->payload, pContext);
+	}
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+/**
+ * @brief Allocate a message that is the recorded size.  The part of the
+ * payload that wasn't recorded is zero.
+ */
+static FwkMsg_t *CreateMsg(const FwkRecordEntry_t *pEntry,
+			   const uint8_t *pPayload)
+{
+	FwkMsg_t *pMsg = BufferPool_TryToTake(
+		sizeof(FwkMsgHeader_t) + pEntry->size, __func__);
+
+	if (pMsg != NULL) {
+		pMsg->header = pEntry->header;
+		memcpy((uint8_t *)pMsg + sizeof(FwkMsgHeader_t), pPayload,
+		       pEntry->length);
+	}
+
+	return pMsg;
+}
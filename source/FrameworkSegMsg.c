@@ -0,0 +1,221 @@
+/**
+ * @file FrameworkSegMsg.c
+ * @brief Segmented framework messages for large payloads.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define FWK_FNAME "FrameworkSegMsg"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <string.h>
+
+#include "BufferPool.h"
+#include "Framework.h"
+#include "FrameworkMsg.h"
+#include "FrameworkSegMsg.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define SEGMENT_SIZE CONFIG_FWK_SEG_MSG_SEGMENT_SIZE
+
+CHECK_BUFFER_SIZE(FWK_SEG_MSG_SEGMENT_ALLOC_SIZE);
+BUILD_ASSERT(CONFIG_FWK_SEG_MSG_SEGMENT_SIZE <= UINT16_MAX,
+	     "Segment size must fit in length");
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static void FreeChain(FwkSegment_t *pSeg);
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+FwkSegMsg_t *FwkSegMsg_Create(FwkId_t TxId, FwkMsgCode_t Code)
+{
+	FwkSegMsg_t *pMsg = BP_TRY_TO_TAKE(sizeof(FwkSegMsg_t));
+
+	if (pMsg != NULL) {
+		FRAMEWORK_MSG_HEADER_INIT(pMsg, Code, TxId);
+		pMsg->header.options = FWK_MSG_OPTION_SEGMENTED;
+	}
+
+	return pMsg;
+}
+
+int FwkSegMsg_Append(FwkSegMsg_t *pMsg, const void *pData, size_t Length)
+{
+	const uint8_t *pSrc = pData;
+	FwkSegment_t *pFirst = NULL;
+	FwkSegment_t *pLast = NULL;
+	FwkSegment_t *pSeg;
+	size_t space = 0;
+	size_t remaining;
+	size_t chunk;
+
+	if (pMsg == NULL || (pData == NULL && Length > 0)) {
+		FRAMEWORK_ASSERT(FORCED);
+		return -EINVAL;
+	}
+
+	if (pMsg->pTail != NULL) {
+		space = SEGMENT_SIZE - pMsg->pTail->length;
+	}
+
+	/* Allocate everything first so that a failure leaves the chain as is */
+	remaining = Length - MIN(space, Length);
+	while (remaining > 0) {
+		pSeg = BP_TRY_TO_TAKE(FWK_SEG_MSG_SEGMENT_ALLOC_SIZE);
+		if (pSeg == NULL) {
+			FreeChain(pFirst);
+			return -ENOMEM;
+		}
+		if (pFirst == NULL) {
+			pFirst = pSeg;
+		} else {
+			pLast->pNext = pSeg;
+		}
+		pLast = pSeg;
+		remaining -= MIN(remaining, SEGMENT_SIZE);
+	}
+
+	remaining = Length;
+	if (space > 0 && remaining > 0) {
+		pSeg = pMsg->pTail;
+		chunk = MIN(space, remaining);
+		memcpy(&pSeg->data[pSeg->length], pSrc, chunk);
+		pSeg->length += chunk;
+		pSrc += chunk;
+		remaining -= chunk;
+	}
+
+	for (pSeg = pFirst; pSeg != NULL; pSeg = pSeg->pNext) {
+		chunk = MIN(remaining, SEGMENT_SIZE);
+		memcpy(pSeg->data, pSrc, chunk);
+		pSeg->length = chunk;
+		pSrc += chunk;
+		remaining -= chunk;
+	}
+
+	if (pFirst != NULL) {
+		if (pMsg->pTail == NULL) {
+			pMsg->pHead = pFirst;
+		} else {
+			pMsg->pTail->pNext = pFirst;
+		}
+		pMsg->pTail = pLast;
+	}
+	pMsg->length += Length;
+
+	return 0;
+}
+
+size_t FwkSegMsg_Read(const FwkSegMsg_t *pMsg, size_t Offset, void *pDest,
+		      size_t Length)
+{
+	uint8_t *pDst = pDest;
+	const FwkSegment_t *pSeg;
+	size_t copied = 0;
+	size_t chunk;
+
+	if (pMsg == NULL || (pDest == NULL && Length > 0)) {
+		FRAMEWORK_ASSERT(FORCED);
+		return 0;
+	}
+
+	for (pSeg = pMsg->pHead; pSeg != NULL && copied < Length;
+	     pSeg = pSeg->pNext) {
+		if (Offset >= pSeg->length) {
+			Offset -= pSeg->length;
+			continue;
+		}
+		chunk = MIN(pSeg->length - Offset, Length - copied);
+		memcpy(&pDst[copied], &pSeg->data[Offset], chunk);
+		copied += chunk;
+		Offset = 0;
+	}
+
+	return copied;
+}
+
+void FwkSegMsg_IterInit(const FwkSegMsg_t *pMsg, FwkSegIter_t *pIter)
+{
+	if (pIter != NULL) {
+		pIter->pSeg = (pMsg != NULL) ? pMsg->pHead : NULL;
+	}
+}
+
+size_t FwkSegMsg_IterNext(FwkSegIter_t *pIter, const uint8_t **ppData)
+{
+	const FwkSegment_t *pSeg;
+
+	if (pIter == NULL || ppData == NULL || pIter->pSeg == NULL) {
+		return 0;
+	}
+
+	pSeg = pIter->pSeg;
+	pIter->pSeg = pSeg->pNext;
+	*ppData = pSeg->data;
+
+	return pSeg->length;
+}
+
+FwkSegMsg_t *FwkSegMsg_Clone(const FwkSegMsg_t *pMsg)
+{
+	FwkSegMsg_t *pCopy;
+	FwkSegIter_t it;
+	const uint8_t *pData;
+	size_t length;
+
+	if (pMsg == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return NULL;
+	}
+
+	pCopy = BP_TRY_TO_TAKE(sizeof(FwkSegMsg_t));
+	if (pCopy == NULL) {
+		return NULL;
+	}
+	pCopy->header = pMsg->header;
+
+	FwkSegMsg_IterInit(pMsg, &it);
+	while ((length = FwkSegMsg_IterNext(&it, &pData)) > 0) {
+		if (FwkSegMsg_Append(pCopy, pData, length) != 0) {
+			FwkSegMsg_Free(pCopy);
+			return NULL;
+		}
+	}
+
+	return pCopy;
+}
+
+void FwkSegMsg_Free(FwkSegMsg_t *pMsg)
+{
+	if (pMsg == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	FreeChain(pMsg->pHead);
+	pMsg->pHead = NULL;
+	pMsg->pTail = NULL;
+	BufferPool_Free(pMsg);
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static void FreeChain(FwkSegment_t *pSeg)
+{
+	FwkSegment_t *pNext;
+
+	while (pSeg != NULL) {
+		pNext = pSeg->pNext;
+		BufferPool_Free(pSeg);
+		pSeg = pNext;
+	}
+}
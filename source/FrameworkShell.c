@@ -0,0 +1,110 @@
+/**
+ * @file FrameworkShell.c
+ * @brief
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <zephyr/zephyr.h>
+#include <zephyr/shell/shell.h>
+
+#include "Framework.h"
+#ifdef CONFIG_FWK_TRAFFIC
+#include "FrameworkTraffic.h"
+#endif
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+#ifdef CONFIG_FWK_TRAFFIC
+static int fwk_traffic(const struct shell *shell, size_t argc, char **argv);
+static int fwk_traffic_dot(const struct shell *shell, size_t argc,
+			   char **argv);
+static int fwk_traffic_reset(const struct shell *shell, size_t argc,
+			     char **argv);
+static void print_edge(const FwkTrafficEdge_t *pEdge, void *pContext);
+static void print_line(const char *pLine, void *pContext);
+#endif
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+#ifdef CONFIG_FWK_TRAFFIC
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	sub_fwk_traffic,
+	SHELL_CMD(dot, NULL, "Print message graph (Graphviz DOT)",
+		  fwk_traffic_dot),
+	SHELL_CMD(reset, NULL, "Clear traffic counters", fwk_traffic_reset),
+	SHELL_SUBCMD_SET_END);
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	sub_fwk,
+	SHELL_COND_CMD(CONFIG_FWK_TRAFFIC, traffic, &sub_fwk_traffic,
+		       "Print messages and bytes by sender, receiver, and code",
+		       fwk_traffic),
+	SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(fwk, &sub_fwk, "Framework", NULL);
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+#ifdef CONFIG_FWK_TRAFFIC
+static int fwk_traffic(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	size_t edges;
+
+	shell_print(shell, "  tx    rx  code      msgs       bytes");
+	edges = FwkTraffic_ForEach(print_edge, (void *)shell);
+	shell_print(shell, "Edges %zu overflows %u", edges,
+		    FwkTraffic_Overflows());
+
+	return 0;
+}
+
+static int fwk_traffic_dot(const struct shell *shell, size_t argc,
+			   char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	FwkTraffic_WriteDot(print_line, (void *)shell);
+
+	return 0;
+}
+
+static int fwk_traffic_reset(const struct shell *shell, size_t argc,
+			     char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	FwkTraffic_Reset();
+
+	return 0;
+}
+
+static void print_edge(const FwkTrafficEdge_t *pEdge, void *pContext)
+{
+	const struct shell *shell = pContext;
+
+	shell_print(shell, "%4u  %4u  %4u %9u %11u", pEdge->txId, pEdge->rxId,
+		    pEdge->msgCode, pEdge->count, pEdge->bytes);
+}
+
+static void print_line(const char *pLine, void *pContext)
+{
+	const struct shell *shell = pContext;
+
+	shell_print(shell, "%s", pLine);
+}
+#endif
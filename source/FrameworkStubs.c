@@ -6,14 +6,12 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include <zephyr/logging/log.h>
+#include "FrameworkOs.h"
 LOG_MODULE_REGISTER(framework_stubs, CONFIG_FRAMEWORK_LOG_LEVEL);
 
 /******************************************************************************/
 /* Includes                                                                   */
 /******************************************************************************/
-#include <zephyr/sys/reboot.h>
-
 #include "Framework.h"
 
 #if defined(CONFIG_LCZ_SOFTWARE_RESET)
@@ -0,0 +1,263 @@
+/**
+ * @file FrameworkTraffic.c
+ * @brief Sender to receiver traffic matrix.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#define FWK_FNAME "FrameworkTraffic"
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "Framework.h"
+#include "FrameworkTraffic.h"
+
+/******************************************************************************/
+/* Local Constant, Macro and Type Definitions                                 */
+/******************************************************************************/
+#define EDGES CONFIG_FWK_TRAFFIC_EDGES
+#define EDGE_MASK (EDGES - 1)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(EDGES), "Traffic edges must be a power of two");
+
+/* The CPU only selects a counter, so a sender that migrates is still
+ * counted (the counters are atomic).
+ */
+#if defined(CONFIG_SMP) && defined(CONFIG_MP_MAX_NUM_CPUS)
+#define CPUS CONFIG_MP_MAX_NUM_CPUS
+#define CURRENT_CPU() (arch_curr_cpu()->id)
+#else
+#define CPUS 1
+#define CURRENT_CPU() 0
+#endif
+
+/* An edge is used after its key is written (it is never removed) */
+typedef struct TrafficKey {
+	atomic_t used;
+	FwkId_t txId;
+	FwkId_t rxId;
+	FwkMsgCode_t msgCode;
+} TrafficKey_t;
+
+typedef struct TrafficCounter {
+	atomic_t count;
+	atomic_t bytes;
+} TrafficCounter_t;
+
+/* DOT export */
+#define WIDTH_MAX 8
+#define LINE_SIZE 96
+
+struct DotContext {
+	FwkTrafficWriter_t writer;
+	void *pContext;
+	uint32_t maxCount;
+};
+
+/******************************************************************************/
+/* Local Function Prototypes                                                  */
+/******************************************************************************/
+static uint32_t Hash(FwkId_t TxId, FwkId_t RxId, FwkMsgCode_t Code);
+static int FindEdge(FwkId_t TxId, FwkId_t RxId, FwkMsgCode_t Code);
+static bool KeyMatch(const TrafficKey_t *pKey, FwkId_t TxId, FwkId_t RxId,
+		     FwkMsgCode_t Code);
+static void MaxCount(const FwkTrafficEdge_t *pEdge, void *pContext);
+static void WriteEdge(const FwkTrafficEdge_t *pEdge, void *pContext);
+
+/******************************************************************************/
+/* Local Data Definitions                                                     */
+/******************************************************************************/
+static struct k_spinlock trafficLock;
+
+static TrafficKey_t trafficKeys[EDGES];
+
+static TrafficCounter_t trafficCounters[CPUS][EDGES];
+
+static atomic_t trafficOverflows;
+
+/******************************************************************************/
+/* Global Function Definitions                                                */
+/******************************************************************************/
+void FwkTraffic_Count(FwkId_t TxId, FwkId_t RxId, FwkMsgCode_t Code,
+		      size_t Size)
+{
+	TrafficCounter_t *pCounter;
+	int edge = FindEdge(TxId, RxId, Code);
+
+	if (edge < 0) {
+		atomic_inc(&trafficOverflows);
+		return;
+	}
+
+	pCounter = &trafficCounters[CURRENT_CPU()][edge];
+	atomic_inc(&pCounter->count);
+	atomic_add(&pCounter->bytes, (atomic_val_t)Size);
+}
+
+size_t FwkTraffic_ForEach(FwkTrafficIterator_t Iterator, void *pContext)
+{
+	TrafficCounter_t *pCounter;
+	FwkTrafficEdge_t edge;
+	size_t edges = 0;
+	uint32_t i;
+	uint32_t cpu;
+
+	if (Iterator == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return 0;
+	}
+
+	for (i = 0; i < EDGES; i++) {
+		if (!atomic_get(&trafficKeys[i].used)) {
+			continue;
+		}
+
+		edge.txId = trafficKeys[i].txId;
+		edge.rxId = trafficKeys[i].rxId;
+		edge.msgCode = trafficKeys[i].msgCode;
+		edge.count = 0;
+		edge.bytes = 0;
+		for (cpu = 0; cpu < CPUS; cpu++) {
+			pCounter = &trafficCounters[cpu][i];
+			edge.count += atomic_get(&pCounter->count);
+			edge.bytes += atomic_get(&pCounter->bytes);
+		}
+
+		if (edge.count > 0) {
+			Iterator(&edge, pContext);
+			edges += 1;
+		}
+	}
+
+	return edges;
+}
+
+void FwkTraffic_Reset(void)
+{
+	uint32_t i;
+	uint32_t cpu;
+
+	for (cpu = 0; cpu < CPUS; cpu++) {
+		for (i = 0; i < EDGES; i++) {
+			atomic_set(&trafficCounters[cpu][i].count, 0);
+			atomic_set(&trafficCounters[cpu][i].bytes, 0);
+		}
+	}
+	atomic_set(&trafficOverflows, 0);
+}
+
+uint32_t FwkTraffic_Overflows(void)
+{
+	return (uint32_t)atomic_get(&trafficOverflows);
+}
+
+void FwkTraffic_WriteDot(FwkTrafficWriter_t Writer, void *pContext)
+{
+	struct DotContext dot = { .writer = Writer, .pContext = pContext };
+
+	if (Writer == NULL) {
+		FRAMEWORK_ASSERT(FORCED);
+		return;
+	}
+
+	FwkTraffic_ForEach(MaxCount, &dot);
+
+	Writer("digraph fwk {", pContext);
+	FwkTraffic_ForEach(WriteEdge, &dot);
+	Writer("}", pContext);
+}
+
+/******************************************************************************/
+/* Local Function Definitions                                                 */
+/******************************************************************************/
+static uint32_t Hash(FwkId_t TxId, FwkId_t RxId, FwkMsgCode_t Code)
+{
+	uint32_t key = ((uint32_t)TxId << 20) ^ ((uint32_t)RxId << 10) ^ Code;
+
+	/* Fibonacci hashing spreads consecutive IDs and codes */
+	return (key * 0x9E3779B1U) >> 16;
+}
+
+/**
+ * @brief Finds the edge of a message.  The edge is added the first time
+ * that it is seen (with a lock).  Lookups don't take the lock.
+ *
+ * @retval index of edge, -1 if the table is full
+ */
+static int FindEdge(FwkId_t TxId, FwkId_t RxId, FwkMsgCode_t Code)
+{
+	uint32_t hash = Hash(TxId, RxId, Code);
+	TrafficKey_t *pKey;
+	uint32_t index;
+	uint32_t i;
+	bool added;
+
+	for (i = 0; i < EDGES; i++) {
+		index = (hash + i) & EDGE_MASK;
+		pKey = &trafficKeys[index];
+
+		if (!atomic_get(&pKey->used)) {
+			k_spinlock_key_t key = k_spin_lock(&trafficLock);
+			added = !atomic_get(&pKey->used);
+			if (added) {
+				pKey->txId = TxId;
+				pKey->rxId = RxId;
+				pKey->msgCode = Code;
+				atomic_set(&pKey->used, 1);
+			}
+			k_spin_unlock(&trafficLock, key);
+
+			if (added) {
+				return (int)index;
+			}
+		}
+
+		/* Another sender may have added an edge to this entry */
+		if (KeyMatch(pKey, TxId, RxId, Code)) {
+			return (int)index;
+		}
+	}
+
+	return -1;
+}
+
+static bool KeyMatch(const TrafficKey_t *pKey, FwkId_t TxId, FwkId_t RxId,
+		     FwkMsgCode_t Code)
+{
+	return (pKey->txId == TxId && pKey->rxId == RxId &&
+		pKey->msgCode == Code);
+}
+
+static void MaxCount(const FwkTrafficEdge_t *pEdge, void *pContext)
+{
+	struct DotContext *pDot = pContext;
+
+	pDot->maxCount = MAX(pDot->maxCount, pEdge->count);
+}
+
+static void WriteEdge(const FwkTrafficEdge_t *pEdge, void *pContext)
+{
+	struct DotContext *pDot = pContext;
+	char line[LINE_SIZE];
+	uint32_t width = 1;
+
+	/* The counters may have grown since the maximum was found */
+	if (pDot->maxCount > 0) {
+		width += (uint32_t)((uint64_t)pEdge->count * (WIDTH_MAX - 1) /
+				    pDot->maxCount);
+		width = MIN(width, WIDTH_MAX);
+	}
+
+	snprintf(line, sizeof(line),
+		 "  %u -> %u [label=\"%u: %u msgs\\n%u B\", penwidth=%u];",
+		 (unsigned int)pEdge->txId, (unsigned int)pEdge->rxId,
+		 (unsigned int)pEdge->msgCode, pEdge->count, pEdge->bytes,
+		 width);
+
+	pDot->writer(line, pDot->pContext);
+}
@@ -2,6 +2,8 @@
 	/* Reserved for framework (DO NOT DELETE, and it must be LAST) */
 	__FRAMEWORK_MAX_MSG_RECEIVERS
 };
+BUILD_ASSERT((__FRAMEWORK_MAX_MSG_RECEIVERS - 1) <= FWK_ID_MAX,
+	     "Too many message receivers (see CONFIG_FWK_WIDE_IDS)");
 
 #ifdef __cplusplus
 }
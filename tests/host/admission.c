@@ -0,0 +1,104 @@
+/**
+ * @file admission.c
+ * @brief Takes are admitted by class and the pressure callbacks report
+ * each change of level.  A rejected take doesn't keep its reservation.
+ * A callback can free buffers.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fwk_test.h"
+
+/* Takes of this size cross the low watermark on the sixth take and the
+ * high watermark on the seventh (of an 8192 byte pool with the default
+ * watermarks).  A take is admitted on the level after the take.
+ */
+#define TAKE_SIZE 1080
+#define TAKES 7
+
+static int changes;
+static enum bp_pressure reported;
+static void *pShed;
+
+static void Pressure(enum bp_pressure level, void *user_data)
+{
+	ARG_UNUSED(user_data);
+	changes += 1;
+	reported = level;
+
+	/* Shed load (which changes the level again) */
+	if (level == BP_PRESSURE_HIGH && pShed != NULL) {
+		BufferPool_Free(pShed);
+		pShed = NULL;
+	}
+}
+
+static struct bp_pressure_callback callback = { .handler = Pressure };
+
+int main(void)
+{
+	void *pBuffers[TAKES];
+	int round;
+	int i;
+
+	BufferPool_AddPressureCallback(&callback);
+
+	/* The result is the same each time (nothing is left reserved) */
+	for (round = 0; round < 2; round++) {
+		changes = 0;
+		for (i = 0; i < TAKES - 2; i++) {
+			pBuffers[i] = BP_TRY_TO_TAKE_CLASS(TAKE_SIZE,
+							   BP_CLASS_BULK);
+			CHECK(pBuffers[i] != NULL);
+		}
+		CHECK(BufferPool_GetPressure() == BP_PRESSURE_NONE);
+		CHECK(changes == 0);
+
+		/* Low pressure rejects bulk takes */
+		CHECK(BP_TRY_TO_TAKE_CLASS(TAKE_SIZE, BP_CLASS_BULK) == NULL);
+		pBuffers[i++] = BP_TRY_TO_TAKE(TAKE_SIZE);
+		CHECK(pBuffers[i - 1] != NULL);
+		CHECK(BufferPool_GetPressure() == BP_PRESSURE_LOW);
+		CHECK(changes == 1 && reported == BP_PRESSURE_LOW);
+		CHECK(BP_TRY_TO_TAKE_CLASS(16, BP_CLASS_BULK) == NULL);
+		CHECK(changes == 1);
+
+		CHECK(BP_TRY_TO_TAKE(TAKE_SIZE) == NULL);
+		pBuffers[i] = BP_TRY_TO_TAKE_CLASS(TAKE_SIZE,
+						   BP_CLASS_CRITICAL);
+		CHECK(pBuffers[i] != NULL);
+		CHECK(changes == 2 && reported == BP_PRESSURE_HIGH);
+
+		/* High pressure rejects normal takes */
+		CHECK(BP_TRY_TO_TAKE(16) == NULL);
+		BufferPool_Free(BP_TRY_TO_TAKE_CLASS(16, BP_CLASS_CRITICAL));
+		CHECK(changes == 2);
+
+		for (i = 0; i < TAKES; i++) {
+			BufferPool_Free(pBuffers[i]);
+		}
+		CHECK(BufferPool_GetPressure() == BP_PRESSURE_NONE);
+		CHECK(changes == 4 && reported == BP_PRESSURE_NONE);
+	}
+
+	/* The change made by the callback is reported after it returns */
+	changes = 0;
+	for (i = 0; i < TAKES - 1; i++) {
+		pBuffers[i] = BP_TRY_TO_TAKE_CLASS(TAKE_SIZE,
+						   BP_CLASS_CRITICAL);
+		CHECK(pBuffers[i] != NULL);
+	}
+	pShed = pBuffers[i - 1];
+	pBuffers[i] = BP_TRY_TO_TAKE_CLASS(TAKE_SIZE, BP_CLASS_CRITICAL);
+	CHECK(pBuffers[i] != NULL && pShed == NULL);
+	CHECK(changes == 3 && reported == BP_PRESSURE_LOW);
+	CHECK(BufferPool_GetPressure() == BP_PRESSURE_LOW);
+	pBuffers[i - 1] = pBuffers[i];
+	for (i = 0; i < TAKES - 1; i++) {
+		BufferPool_Free(pBuffers[i]);
+	}
+	CHECK(BufferPool_GetPressure() == BP_PRESSURE_NONE);
+
+	return 0;
+}
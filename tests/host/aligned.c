@@ -0,0 +1,73 @@
+/**
+ * @file aligned.c
+ * @brief Aligned takes (of a buffer or a member) with the allocation
+ * site tracking that starts each block.  The track must stay aligned
+ * and the aged buffer list must find the header after the padding.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+
+#include "fwk_test.h"
+
+#define TAKES 8
+
+static const size_t offsets[] = { 0, 1, 3, 4, 12, 17 };
+
+/* The padding (if any) is between the track and the header */
+static uintptr_t Track(const uint8_t *pBuffer)
+{
+	const uint8_t *pHeader = pBuffer - BP_HEADER_SIZE;
+	size_t pad = pHeader[-1];
+
+	return (uintptr_t)(pHeader - pad - BP_TRACK_SIZE);
+}
+
+static void TakeAll(size_t Offset)
+{
+	struct bp_aged_buffer list[TAKES];
+	uint8_t *pBuffer[TAKES];
+	size_t align;
+	size_t i;
+
+	for (i = 0, align = 1; i < TAKES; i++, align <<= 1) {
+		CHECK(align <= BP_ALIGN_MAX);
+		pBuffer[i] = BufferPool_TryToTakeAligned(i + 5, align, Offset,
+							 __func__);
+		CHECK(pBuffer[i] != NULL);
+		CHECK(((uintptr_t)pBuffer[i] + Offset) % align == 0);
+		CHECK(Track(pBuffer[i]) % __alignof__(struct bp_track) == 0);
+		memset(pBuffer[i], 0xff, i + 5);
+	}
+
+	/* Oldest first */
+	CHECK(BufferPool_GetAgedBuffers(0, list, TAKES) == TAKES);
+	for (i = 0; i < TAKES; i++) {
+		CHECK(list[i].buffer == pBuffer[i]);
+		CHECK(list[i].size == i + 5);
+		CHECK(BufferPool_GetSize(pBuffer[i]) == i + 5);
+	}
+
+	for (i = 0; i < TAKES; i++) {
+		BufferPool_Free(pBuffer[i]);
+	}
+	CHECK(BufferPool_GetAgedBuffers(0, list, TAKES) == 0);
+}
+
+int main(void)
+{
+	struct bp_site_stats stats;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(offsets); i++) {
+		TakeAll(offsets[i]);
+	}
+
+	CHECK(BufferPool_GetSiteStats(0, &stats) == 0);
+	CHECK(stats.live_count == 0 && stats.live_bytes == 0);
+	CHECK(stats.total_allocs == TAKES * ARRAY_SIZE(offsets));
+
+	return 0;
+}
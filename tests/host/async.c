@@ -0,0 +1,88 @@
+/**
+ * @file async.c
+ * @brief A request that isn't answered calls its continuation when the
+ * timeout expires even if the receiver isn't sent any other messages.
+ *
+ * Time is virtual, so the timers expire in k_sleep.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fwk_test.h"
+#include "FrameworkAsync.h"
+
+TEST_RECEIVER_DEFINE(rxA, 1);
+TEST_RECEIVER_DEFINE(rxB, 2);
+
+static int resumed;
+static int timedOut;
+
+static DispatchResult_t Done(FwkMsgReceiver_t *pRxer, FwkMsg_t *pReply,
+			     void *pFrame)
+{
+	ARG_UNUSED(pRxer);
+	ARG_UNUSED(pFrame);
+
+	resumed += 1;
+	if (pReply == NULL) {
+		timedOut += 1;
+	}
+	return DISPATCH_OK;
+}
+
+static FwkAsyncMsg_t *TakeAsync(void)
+{
+	FwkAsyncMsg_t *pMsg = BP_TRY_TO_TAKE(sizeof(FwkAsyncMsg_t));
+
+	CHECK(pMsg != NULL);
+	pMsg->header.msgCode = FMC_PERIODIC;
+	pMsg->header.options = 0;
+	return pMsg;
+}
+
+int main(void)
+{
+	FwkMsg_t *pRequest = NULL;
+
+	Framework_RegisterReceiver(&rxA);
+	Framework_RegisterReceiver(&rxB);
+
+	/* The timer wakes the receiver when the request times out */
+	CHECK(FwkAsync_Request(&rxA, rxB.id, TakeAsync(), Done, NULL,
+			       K_MSEC(20)) == 0);
+	k_sleep(K_MSEC(10));
+	Framework_MsgReceiver(&rxA);
+	CHECK(resumed == 0);
+	k_sleep(K_MSEC(15));
+	Framework_MsgReceiver(&rxA);
+	CHECK(timedOut == 1);
+	CHECK(testHandled == 0);
+	CHECK(Framework_Flush(rxB.id) == 1);
+
+	/* A request without a timeout waits for its reply */
+	CHECK(FwkAsync_Request(&rxA, rxB.id, TakeAsync(), Done, NULL,
+			       K_FOREVER) == 0);
+	k_sleep(K_SECONDS(10));
+	CHECK(k_msgq_num_used_get(rxA.pQueue) == 0);
+	CHECK(Framework_Receive(rxB.pQueue, &pRequest, K_NO_WAIT) == 0);
+	CHECK(FwkAsync_Reply((FwkAsyncMsg_t *)pRequest, TakeAsync()) ==
+	      FWK_SUCCESS);
+	Framework_FreeMsg(pRequest);
+	Framework_MsgReceiver(&rxA);
+	CHECK(resumed == 2 && timedOut == 1);
+
+	/* A reply stops the timer */
+	CHECK(FwkAsync_Request(&rxA, rxB.id, TakeAsync(), Done, NULL,
+			       K_MSEC(20)) == 0);
+	CHECK(Framework_Receive(rxB.pQueue, &pRequest, K_NO_WAIT) == 0);
+	CHECK(FwkAsync_Reply((FwkAsyncMsg_t *)pRequest, TakeAsync()) ==
+	      FWK_SUCCESS);
+	Framework_FreeMsg(pRequest);
+	Framework_MsgReceiver(&rxA);
+	k_sleep(K_MSEC(50));
+	CHECK(k_msgq_num_used_get(rxA.pQueue) == 0);
+	CHECK(resumed == 3 && timedOut == 1);
+
+	return 0;
+}
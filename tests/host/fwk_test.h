@@ -0,0 +1,85 @@
+/**
+ * @file fwk_test.h
+ * @brief Checks and receivers shared by the host tests.
+ *
+ * A test is a program that returns 0 when it passes.  Framework
+ * assertions are enabled and a test fails if one fires.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __FWK_TEST_H__
+#define __FWK_TEST_H__
+
+/******************************************************************************/
+/* Includes                                                                   */
+/******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Framework.h"
+#include "BufferPool.h"
+
+/******************************************************************************/
+/* Global Constants, Macros and Type Definitions                              */
+/******************************************************************************/
+#define CHECK(expr)                                                            \
+	do {                                                                   \
+		if (!(expr)) {                                                 \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, \
+				__LINE__, #expr);                              \
+			exit(1);                                               \
+		}                                                              \
+	} while (0)
+
+#define TEST_QUEUE_DEPTH 8
+
+/* A receiver whose dispatcher accepts every code */
+#define TEST_RECEIVER_DEFINE(name, rx_id)                                      \
+	K_MSGQ_DEFINE(name##_queue, FWK_QUEUE_ENTRY_SIZE, TEST_QUEUE_DEPTH,    \
+		      FWK_QUEUE_ALIGNMENT);                                    \
+	static FwkMsgReceiver_t name = {                                       \
+		.id = (rx_id),                                                 \
+		.pQueue = &name##_queue,                                       \
+		.rxBlockTicks = K_NO_WAIT,                                     \
+		.pMsgDispatcher = TestDispatcher,                              \
+	}
+
+/******************************************************************************/
+/* Test Data and Functions                                                    */
+/******************************************************************************/
+static int testHandled;
+
+void Framework_AssertionHandler(char *file, int line)
+{
+	fprintf(stderr, "%s:%d: framework assertion\n", file, line);
+	exit(1);
+}
+
+static DispatchResult_t TestHandler(FwkMsgReceiver_t *pMsgRxer,
+				    FwkMsg_t *pMsg)
+{
+	ARG_UNUSED(pMsgRxer);
+	ARG_UNUSED(pMsg);
+
+	testHandled += 1;
+	return DISPATCH_OK;
+}
+
+static __unused FwkMsgHandler_t *TestDispatcher(FwkMsgCode_t MsgCode)
+{
+	return (MsgCode != FMC_INVALID) ? TestHandler : NULL;
+}
+
+static __unused FwkMsg_t *TestTake(FwkMsgCode_t Code, FwkId_t TxId)
+{
+	FwkMsg_t *pMsg = BufferPool_TryToTake(sizeof(FwkMsg_t), __func__);
+
+	CHECK(pMsg != NULL);
+	pMsg->header.msgCode = Code;
+	pMsg->header.txId = TxId;
+	return pMsg;
+}
+
+#endif /* __FWK_TEST_H__ */
@@ -0,0 +1,84 @@
+/**
+ * @file integrity.c
+ * @brief Overflow, double free, and use after free checks.  A freed
+ * buffer stays in quarantine until a take needs the space.
+ *
+ * The first free (and then one of every CONFIG_BUFFER_POOL_INTEGRITY_SAMPLE)
+ * is put in quarantine.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+
+#include "fwk_test.h"
+
+#define FILL_SIZE 256
+#define FILL_MAX (CONFIG_BUFFER_POOL_SIZE / FILL_SIZE)
+
+static int errors[BP_INTEGRITY_USE_AFTER_FREE + 1];
+static const char *lastContext;
+
+void BufferPool_IntegrityHandler(enum bp_integrity_error error, void *buffer,
+				 const char *context)
+{
+	ARG_UNUSED(buffer);
+
+	errors[error] += 1;
+	lastContext = context;
+}
+
+int main(void)
+{
+	uint8_t *pFill[FILL_MAX];
+	uint8_t *pQuarantined;
+	uint8_t *pBuffer;
+	size_t count;
+	size_t i;
+
+	/* The first free is held in quarantine */
+	pQuarantined = BP_TRY_TO_TAKE(32);
+	CHECK(pQuarantined != NULL);
+	BufferPool_Free(pQuarantined);
+
+	/* A double free of a buffer in quarantine is always found */
+	BufferPool_Free(pQuarantined);
+	CHECK(errors[BP_INTEGRITY_DOUBLE_FREE] == 1);
+	CHECK(strcmp(lastContext, "heap") == 0);
+
+	/* Write after free */
+	pQuarantined[0] = 0;
+
+	/* Takes that fit don't release the quarantine */
+	for (i = 0; i < 4; i++) {
+		pBuffer = BP_TRY_TO_TAKE(16);
+		CHECK(pBuffer != NULL);
+		BufferPool_Free(pBuffer);
+	}
+	CHECK(errors[BP_INTEGRITY_USE_AFTER_FREE] == 0);
+
+	/* Fill the heap so that the quarantine is released (and checked) */
+	for (count = 0; count < FILL_MAX; count++) {
+		pFill[count] = BP_TRY_TO_TAKE(FILL_SIZE);
+		if (pFill[count] == NULL) {
+			break;
+		}
+	}
+	CHECK(count > 0 && count < FILL_MAX);
+	CHECK(errors[BP_INTEGRITY_USE_AFTER_FREE] == 1);
+	for (i = 0; i < count; i++) {
+		BufferPool_Free(pFill[i]);
+	}
+
+	/* Overflow into the guard */
+	pBuffer = BP_TRY_TO_TAKE(8);
+	CHECK(pBuffer != NULL);
+	pBuffer[8] = 0;
+	BufferPool_Free(pBuffer);
+	CHECK(errors[BP_INTEGRITY_OVERFLOW] == 1);
+	CHECK(strcmp(lastContext, "heap") == 0);
+
+	CHECK(errors[BP_INTEGRITY_BAD_HEADER] == 0);
+	return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file liveness.c
+ * @brief Liveness counters are updated by every receive path and the
+ * waiting time is the enqueue time of the head of the queue.
+ *
+ * Time is virtual, so uptimes are exact.  A receiver thread with a higher
+ * priority than the sender takes a message before the send returns.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fwk_test.h"
+
+TEST_RECEIVER_DEFINE(rxA, 1);
+TEST_RECEIVER_DEFINE(rxB, 2);
+
+K_THREAD_STACK_DEFINE(rxBStack, 1024);
+static struct k_thread rxBThread;
+
+static uint32_t Waiting(void)
+{
+	return (uint32_t)atomic_get(&rxA.waitingMs);
+}
+
+static uint32_t Progress(void)
+{
+	return (uint32_t)atomic_get(&rxA.progress);
+}
+
+static void RxBThread(void *p1, void *p2, void *p3)
+{
+	while (true) {
+		Framework_MsgReceiver(&rxB);
+	}
+}
+
+int main(void)
+{
+	FwkMsg_t *pMsg;
+
+	Framework_RegisterReceiver(&rxA);
+	CHECK(Waiting() == 0);
+
+	/* The first message sets the time, the second doesn't */
+	k_sleep(K_MSEC(10));
+	CHECK(Framework_Send(rxA.id, TestTake(FMC_PERIODIC, 2)) ==
+	      FWK_SUCCESS);
+	k_sleep(K_MSEC(5));
+	CHECK(Framework_Send(rxA.id, TestTake(FMC_PERIODIC, 2)) ==
+	      FWK_SUCCESS);
+	CHECK(Waiting() == 10);
+
+	/* The next head waited from when it was queued (not from now) */
+	k_sleep(K_MSEC(15));
+	Framework_MsgReceiver(&rxA);
+	CHECK(Progress() == 1);
+	CHECK(Waiting() == 15);
+
+	/* A receiver that doesn't dispatch isn't left waiting */
+	pMsg = NULL;
+	CHECK(Framework_Receive(rxA.pQueue, &pMsg, K_NO_WAIT) == 0);
+	CHECK(pMsg != NULL);
+	Framework_FreeMsg(pMsg);
+	CHECK(Progress() == 2);
+	CHECK(Waiting() == 0);
+
+	/* A message put on the queue directly has the reserved ID */
+	k_sleep(K_MSEC(10));
+	pMsg = TestTake(FMC_PERIODIC, 1);
+	CHECK(Framework_Queue(rxA.pQueue, &pMsg, K_NO_WAIT) == 0);
+	CHECK(Waiting() == 40);
+	CHECK(Framework_Flush(rxA.id) == 1);
+	CHECK(Progress() == 3);
+	CHECK(Waiting() == 0);
+
+	CHECK(testHandled == 1);
+
+	/* The receiver runs (and finds its queue empty) before the sender
+	 * returns, so it isn't left waiting.
+	 */
+	rxB.rxBlockTicks = K_FOREVER;
+	Framework_RegisterReceiver(&rxB);
+	k_thread_priority_set(k_current_get(), 2);
+	k_thread_create(&rxBThread, rxBStack,
+			K_THREAD_STACK_SIZEOF(rxBStack), RxBThread, NULL, NULL,
+			NULL, 1, 0, K_NO_WAIT);
+	k_sleep(K_MSEC(10));
+	CHECK(Framework_Send(rxB.id, TestTake(FMC_PERIODIC, 2)) ==
+	      FWK_SUCCESS);
+	CHECK(testHandled == 2);
+	CHECK(atomic_get(&rxB.progress) == 1);
+	CHECK(atomic_get(&rxB.waitingMs) == 0);
+
+	return 0;
+}
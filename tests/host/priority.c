@@ -0,0 +1,80 @@
+/**
+ * @file priority.c
+ * @brief A priority message raises the receiver thread until it is
+ * dispatched, received, or flushed.  Only the messages that were counted
+ * (queued after the receiver recorded its thread) restore the priority.
+ *
+ * The main thread is the receiver.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fwk_test.h"
+#include "FrameworkMsg.h"
+
+#define BASE_PRIORITY 5
+#define MSG_PRIORITY 2
+
+TEST_RECEIVER_DEFINE(rxA, 1);
+
+static void SendPriority(void)
+{
+	FwkMsg_t *pMsg = TestTake(FMC_PERIODIC, 2);
+
+	FRAMEWORK_MSG_SET_PRIORITY(pMsg, MSG_PRIORITY);
+	CHECK(Framework_Send(rxA.id, pMsg) == FWK_SUCCESS);
+}
+
+static int Priority(void)
+{
+	return k_thread_priority_get(k_current_get());
+}
+
+int main(void)
+{
+	FwkMsg_t *pMsg;
+
+	k_thread_priority_set(k_current_get(), BASE_PRIORITY);
+	Framework_RegisterReceiver(&rxA);
+
+	/* Queued before the receiver recorded its thread (not counted) */
+	SendPriority();
+	SendPriority();
+	Framework_MsgReceiver(&rxA);
+	CHECK(rxA.boosted == 0 && Priority() == BASE_PRIORITY);
+
+	/* Dispatching an uncounted message doesn't remove the boost */
+	SendPriority();
+	CHECK(rxA.boosted == 1 && Priority() == MSG_PRIORITY);
+	Framework_MsgReceiver(&rxA);
+	CHECK(rxA.boosted == 1 && Priority() == MSG_PRIORITY);
+	Framework_MsgReceiver(&rxA);
+	CHECK(rxA.boosted == 0 && Priority() == BASE_PRIORITY);
+	CHECK(testHandled == 3);
+
+	/* Flush */
+	SendPriority();
+	SendPriority();
+	CHECK(rxA.boosted == 2 && Priority() == MSG_PRIORITY);
+	CHECK(Framework_Flush(rxA.id) == 2);
+	CHECK(rxA.boosted == 0 && Priority() == BASE_PRIORITY);
+
+	/* Receive without dispatch */
+	SendPriority();
+	pMsg = NULL;
+	CHECK(Framework_Receive(rxA.pQueue, &pMsg, K_NO_WAIT) == 0);
+	CHECK(pMsg != NULL);
+	CHECK(!(pMsg->header.options & FWK_MSG_OPTION_BOOSTED));
+	CHECK(rxA.boosted == 0 && Priority() == BASE_PRIORITY);
+	Framework_FreeMsg(pMsg);
+
+	/* Unregister */
+	SendPriority();
+	CHECK(Priority() == MSG_PRIORITY);
+	CHECK(Framework_UnregisterReceiver(&rxA) == 1);
+	CHECK(rxA.boosted == 0 && Priority() == BASE_PRIORITY);
+
+	CHECK(testHandled == 3);
+	return 0;
+}
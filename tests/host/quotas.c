@@ -0,0 +1,87 @@
+/**
+ * @file quotas.c
+ * @brief Buffers are charged to their owner until they are freed.
+ * Buffers without an owner (including type pool buffers) aren't charged.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fwk_test.h"
+
+typedef struct TestMsg {
+	FwkMsgHeader_t header;
+	uint32_t value;
+} TestMsg_t;
+
+#define FWK_TYPE_POOL_ID_TestMsg_t 1
+
+K_MEM_SLAB_DEFINE_STATIC(testMsgSlab, BP_TYPE_POOL_BLOCK_SIZE(TestMsg_t), 2,
+			 sizeof(void *));
+
+const struct bp_type_pool fwk_type_pools[] = {
+	{ &testMsgSlab, "TestMsg_t", sizeof(TestMsg_t), 2 },
+	{ NULL, NULL, 0, 0 }
+};
+const uint8_t fwk_type_pool_count = 1;
+
+TEST_RECEIVER_DEFINE(rxA, 1);
+TEST_RECEIVER_DEFINE(rxB, 2);
+
+static uint32_t Used(uint16_t Id)
+{
+	struct bp_quota_stats stats;
+
+	CHECK(BufferPool_GetQuotaStats(Id, &stats) == 0);
+	return stats.used;
+}
+
+int main(void)
+{
+	struct bp_quota_stats stats;
+	TestMsg_t *pTestMsg;
+	FwkMsg_t *pMsg;
+	void *pBuffer;
+	uint32_t charge;
+
+	Framework_RegisterReceiver(&rxA);
+	Framework_RegisterReceiver(&rxB);
+
+	/* The charge includes the overhead and is released by free */
+	pBuffer = BP_TRY_TO_TAKE_ID(100, 3);
+	CHECK(pBuffer != NULL);
+	charge = Used(3);
+	CHECK(charge >= 100);
+	BufferPool_Free(pBuffer);
+	CHECK(Used(3) == 0);
+
+	/* A take that would exceed the quota fails without waiting */
+	CHECK(BufferPool_SetQuota(3, charge) == 0);
+	pBuffer = BP_TRY_TO_TAKE_ID(100, 3);
+	CHECK(pBuffer != NULL);
+	CHECK(BP_TRY_TO_TAKE_ID(1, 3) == NULL);
+	CHECK(BufferPool_GetQuotaStats(3, &stats) == 0);
+	CHECK(stats.failures == 1 && stats.peak == charge);
+	BufferPool_Free(pBuffer);
+	CHECK(BufferPool_SetQuota(3, 0) == 0);
+
+	/* Buffers without an owner don't change ID 0 */
+	BufferPool_Free(BP_TRY_TO_TAKE(16));
+	pTestMsg = BP_TYPE_POOL_TAKE(TestMsg_t);
+	CHECK(pTestMsg != NULL);
+	BufferPool_Free(pTestMsg);
+	CHECK(Used(0) == 0);
+
+	/* Broadcast copies are charged to the sender until they are freed */
+	pMsg = TestTake(FMC_APPLICATION_SPECIFIC_START, 3);
+	CHECK(Framework_Broadcast(pMsg, sizeof(FwkMsg_t)) == FWK_SUCCESS);
+	CHECK(Used(3) > 0);
+	Framework_MsgReceiver(&rxA);
+	Framework_MsgReceiver(&rxB);
+	CHECK(testHandled == 2);
+	CHECK(Used(3) == 0);
+	CHECK(Used(0) == 0);
+
+	CHECK(BufferPool_SetQuota(BufferPool_GetQuotaIds(), 1) == -EINVAL);
+	return 0;
+}
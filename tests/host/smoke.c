@@ -0,0 +1,52 @@
+/**
+ * @file smoke.c
+ * @brief Send, broadcast, and dispatch with the options of the library
+ * that the test is linked with.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fwk_test.h"
+
+#ifdef CONFIG_FWK_TYPE_POOLS
+const struct bp_type_pool fwk_type_pools[] = { { NULL, NULL, 0, 0 } };
+const uint8_t fwk_type_pool_count = 0;
+#endif
+
+TEST_RECEIVER_DEFINE(rxA, 1);
+TEST_RECEIVER_DEFINE(rxB, 2);
+
+int main(void)
+{
+	FwkMsg_t *pMsg;
+
+	Framework_RegisterReceiver(&rxA);
+	Framework_RegisterReceiver(&rxB);
+
+	CHECK(Framework_Send(rxA.id, TestTake(FMC_PERIODIC, 2)) ==
+	      FWK_SUCCESS);
+	Framework_MsgReceiver(&rxA);
+	CHECK(testHandled == 1);
+
+	pMsg = TestTake(FMC_APPLICATION_SPECIFIC_START, 1);
+	CHECK(Framework_Broadcast(pMsg, sizeof(FwkMsg_t)) == FWK_SUCCESS);
+	Framework_MsgReceiver(&rxA);
+	Framework_MsgReceiver(&rxB);
+	CHECK(testHandled == 3);
+
+	CHECK(Framework_Send(rxB.id, TestTake(FMC_PERIODIC, 1)) ==
+	      FWK_SUCCESS);
+	CHECK(Framework_UnregisterReceiver(&rxB) == 1);
+	CHECK(Framework_Send(rxB.id, pMsg = TestTake(FMC_PERIODIC, 1)) ==
+	      FWK_ERROR);
+	BufferPool_Free(pMsg);
+
+	/* A receiver can be registered again */
+	Framework_RegisterReceiver(&rxB);
+	CHECK(Framework_Send(rxB.id, TestTake(FMC_PERIODIC, 1)) ==
+	      FWK_SUCCESS);
+	CHECK(Framework_UnregisterReceiver(&rxB) == 1);
+
+	return 0;
+}
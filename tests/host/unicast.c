@@ -0,0 +1,41 @@
+/**
+ * @file unicast.c
+ * @brief Unicast uses the cached route for a code until a receiver is
+ * registered or unregistered.
+ *
+ * Copyright (c) 2022 Laird Connectivity
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fwk_test.h"
+
+TEST_RECEIVER_DEFINE(rxA, 1);
+TEST_RECEIVER_DEFINE(rxB, 2);
+
+static uint32_t Queued(FwkMsgReceiver_t *pRxer)
+{
+	return k_msgq_num_used_get(pRxer->pQueue);
+}
+
+int main(void)
+{
+	/* The route to the only receiver is cached */
+	Framework_RegisterReceiver(&rxB);
+	CHECK(Framework_Unicast(TestTake(FMC_PERIODIC, 3)) == FWK_SUCCESS);
+	CHECK(Framework_Unicast(TestTake(FMC_PERIODIC, 3)) == FWK_SUCCESS);
+	CHECK(Queued(&rxB) == 2);
+
+	/* A lower ID that handles the code is found after it registers */
+	Framework_RegisterReceiver(&rxA);
+	CHECK(Framework_Unicast(TestTake(FMC_PERIODIC, 3)) == FWK_SUCCESS);
+	CHECK(Queued(&rxA) == 1 && Queued(&rxB) == 2);
+
+	/* And the next receiver after it unregisters */
+	CHECK(Framework_UnregisterReceiver(&rxA) == 1);
+	CHECK(Framework_Unicast(TestTake(FMC_PERIODIC, 3)) == FWK_SUCCESS);
+	CHECK(Queued(&rxB) == 3);
+
+	CHECK(Framework_Flush(rxB.id) == 3);
+	CHECK(testHandled == 0);
+	return 0;
+}